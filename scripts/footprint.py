@@ -0,0 +1,262 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2017 Linaro Limited
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+
+"""RAM and flash footprint per subsystem, checked against a budget.
+
+Static RAM and flash are attributed to subsystems from the symbols of
+zephyr.elf and the source file each one comes from (nm -l, so the
+image must have debug info, which Zephyr builds do by default). Source
+paths are classified relative to the application directory and to
+ZEPHYR_BASE, so where either is checked out does not matter. Thread
+stack high-water marks come from a console log of a build with
+footprint.conf, which prints them periodically; the highest one is
+checked. With CONFIG_STACK_USAGE, the largest static stack frame of
+each subsystem is listed too.
+
+Budgets are read from boards/<BOARD>.budget:
+
+    # subsystem   ram     flash
+    app           8192    40960
+    total         61440   204800
+    # stack       thread  high-water mark, in bytes or % of the stack
+    stack         main    90%
+
+A "-" leaves a figure unchecked. The script exits with status 1 when
+any budget is exceeded.
+"""
+
+import argparse
+import collections
+import os
+import re
+import shutil
+import subprocess
+import sys
+
+APP = 'app'
+ZEPHYR = 'zephyr'
+
+# First match wins; patterns are matched against the path of the
+# symbol's source file, relative to the application directory (APP)
+# or to ZEPHYR_BASE (ZEPHYR)
+SUBSYSTEMS = [
+    ('app_wq', APP, r'^src/(app_work_queue|timer_wheel)\.c$'),
+    ('logging', APP, r'^src/tstamp_log\.c$'),
+    ('logging', ZEPHYR, r'^(subsys/logging/|misc/printk\.c$)'),
+    ('fota', APP, r'^src/lib/'),
+    ('app', APP, r'^src/'),
+    ('bluetooth', ZEPHYR,
+     r'^((subsys|drivers)/bluetooth/|ext/lib/crypto/tinycrypt/)'),
+    ('kernel', ZEPHYR, r'^(kernel|arch)/'),
+]
+OTHER = 'other'
+ORDER = list(collections.OrderedDict(
+    (name, None) for name, _, _ in SUBSYSTEMS)) + [OTHER]
+
+# nm symbol types
+FLASH_TYPES = set('tTrRdD')
+RAM_TYPES = set('dDbB')
+
+# stack_analyze() output
+STACK_RE = re.compile(r'(\S+) \(real size \d+\):\s*unused (\d+)\s*'
+                      r'usage (\d+) / (\d+)')
+
+
+def relative_to(path, base):
+    rel = os.path.relpath(path, base)
+    if rel == os.pardir or rel.startswith(os.pardir + os.sep):
+        return None
+    return rel.replace(os.sep, '/')
+
+
+def subsystem_of(path, roots):
+    """Subsystem of an absolute source path, roots maps APP and ZEPHYR
+    to their directories."""
+    path = os.path.normpath(path)
+    for name, root, pattern in SUBSYSTEMS:
+        if not roots.get(root):
+            continue
+        rel = relative_to(path, roots[root])
+        if rel and re.search(pattern, rel):
+            return name
+    return OTHER
+
+
+def find_nm(nm):
+    candidates = [nm] if nm else []
+    candidates += [os.environ.get('CROSS_COMPILE', '') + 'nm',
+                   'arm-zephyr-eabi-nm', 'arm-none-eabi-nm', 'nm']
+    for candidate in candidates:
+        if candidate and shutil.which(candidate):
+            return candidate
+    sys.exit('footprint: no nm found, use --nm')
+
+
+def symbol_sizes(elf, nm, roots):
+    # Relative paths in the debug info are relative to the build
+    outdir = os.path.dirname(os.path.abspath(elf))
+    ram = collections.Counter()
+    flash = collections.Counter()
+    out = subprocess.check_output([nm, '-S', '-l', '--size-sort', elf],
+                                  universal_newlines=True)
+    for line in out.splitlines():
+        # address size type name[\tfile:line]
+        fields = line.split('\t')
+        parts = fields[0].split()
+        if len(parts) < 4:
+            continue
+        size, kind = int(parts[1], 16), parts[2]
+        path = fields[1].rsplit(':', 1)[0] if len(fields) > 1 else ''
+        if path:
+            subsystem = subsystem_of(os.path.join(outdir, path), roots)
+        else:
+            subsystem = OTHER
+        if kind in FLASH_TYPES:
+            flash[subsystem] += size
+        if kind in RAM_TYPES:
+            ram[subsystem] += size
+    return ram, flash
+
+
+def stack_marks(log):
+    marks = {}
+    with open(log, errors='replace') as f:
+        for line in f:
+            m = STACK_RE.search(line)
+            if m:
+                # Marks are logged periodically: keep the peak
+                used = max(int(m.group(3)), marks.get(m.group(1), (0,))[0])
+                marks[m.group(1)] = (used, int(m.group(4)))
+    return marks
+
+
+def largest_frames(outdir, roots):
+    frames = {}
+    for root, _, files in os.walk(outdir):
+        for name in files:
+            if not name.endswith('.su'):
+                continue
+            # The build tree mirrors the sources: the application's
+            # under src/, Zephyr's from the top
+            rel = relative_to(os.path.join(root, name[:-3] + '.c'), outdir)
+            base = roots.get(APP if rel.startswith('src/') else ZEPHYR)
+            if not base:
+                continue
+            subsystem = subsystem_of(os.path.join(base, rel), roots)
+            with open(os.path.join(root, name)) as f:
+                for line in f:
+                    fields = line.split('\t')
+                    if len(fields) < 2:
+                        continue
+                    size = int(fields[1])
+                    func = fields[0].rsplit(':', 1)[-1]
+                    if size > frames.get(subsystem, (0, ''))[0]:
+                        frames[subsystem] = (size, func)
+    return frames
+
+
+def read_budget(path):
+    budget = {}
+    stacks = {}
+
+    def value(field):
+        if field == '-':
+            return None
+        if field.endswith('%'):
+            return ('%', int(field[:-1]))
+        return int(field, 0)
+
+    with open(path) as f:
+        for line in f:
+            fields = line.split('#', 1)[0].split()
+            if not fields:
+                continue
+            if fields[0] == 'stack' and len(fields) == 3:
+                stacks[fields[1]] = value(fields[2])
+            elif len(fields) == 3:
+                budget[fields[0]] = (value(fields[1]), value(fields[2]))
+            else:
+                sys.exit('footprint: %s: bad line: %s' % (path, line))
+    return budget, stacks
+
+
+def check(used, limit):
+    if limit is None:
+        return '', True
+    ok = used <= limit
+    return '%6d %4d%%%s' % (limit, 100 * used // max(limit, 1),
+                            '' if ok else '  OVER'), ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('--elf', required=True, help='zephyr.elf')
+    parser.add_argument('--budget', help='budget file')
+    parser.add_argument('--stack-log', help='console log with stack marks')
+    parser.add_argument('--nm', help='nm of the target toolchain')
+    parser.add_argument('--app-dir', default=os.getcwd(),
+                        help='application directory (default: current)')
+    parser.add_argument('--zephyr-base', default=os.environ.get('ZEPHYR_BASE'),
+                        help='Zephyr tree (default: $ZEPHYR_BASE)')
+    args = parser.parse_args()
+
+    roots = {APP: os.path.abspath(args.app_dir)}
+    if args.zephyr_base:
+        roots[ZEPHYR] = os.path.abspath(args.zephyr_base)
+
+    ram, flash = symbol_sizes(args.elf, find_nm(args.nm), roots)
+    ram['total'] = sum(ram.values())
+    flash['total'] = sum(flash.values())
+
+    budget, stack_budget = ({}, {})
+    if args.budget:
+        budget, stack_budget = read_budget(args.budget)
+
+    ok = True
+    print('%-10s %8s %13s %8s %13s' % ('', 'RAM', 'budget', 'flash',
+                                      'budget'))
+    for name in ORDER + ['total']:
+        ram_limit, flash_limit = budget.get(name, (None, None))
+        ram_check, ram_ok = check(ram[name], ram_limit)
+        flash_check, flash_ok = check(flash[name], flash_limit)
+        ok &= ram_ok and flash_ok
+        print('%-10s %8d %-13s %8d %s' % (name, ram[name], ram_check,
+                                         flash[name], flash_check))
+
+    if args.stack_log:
+        marks = stack_marks(args.stack_log)
+        if not marks:
+            print('\nno stack marks in %s (build with footprint.conf)' %
+                  args.stack_log)
+        else:
+            print('\n%-10s %8s %8s %13s' % ('stack', 'used', 'size',
+                                           'budget'))
+        for name, (used, size) in sorted(marks.items()):
+            limit = stack_budget.get(name)
+            if isinstance(limit, tuple):
+                limit = size * limit[1] // 100
+            stack_check, stack_ok = check(used, limit)
+            ok &= stack_ok
+            print('%-10s %8d %8d %s' % (name, used, size, stack_check))
+
+    frames = largest_frames(os.path.dirname(os.path.abspath(args.elf)),
+                            roots)
+    if frames:
+        print('\n%-10s %8s  %s' % ('frame', 'bytes', 'function'))
+        for name in ORDER:
+            if name in frames:
+                print('%-10s %8d  %s' % (name, frames[name][0],
+                                         frames[name][1]))
+
+    if not ok:
+        print('\nfootprint: budget exceeded')
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
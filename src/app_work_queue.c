@@ -15,35 +15,128 @@
  * (in our case, the main thread) isn't using its stack for the
  * application's lifetime, and could be doing useful work instead.
  *
+ * With CONFIG_APP_WQ_SINGLE_STACK, the same is done for the system
+ * work queue (used by the Bluetooth host and mesh stacks): its thread
+ * is stopped, and its queue is served by the main thread as a higher
+ * priority lane than the application queue.
+ *
  * TODO: propose a more upstream-friendly way to support this.
  */
 
+#define SYS_LOG_DOMAIN "fota/app_wq"
+#define SYS_LOG_LEVEL CONFIG_SYS_LOG_FOTA_LEVEL
+#include <logging/sys_log.h>
+
+#include <misc/stack.h>
+
 #include "app_work_queue.h"
+#include "timer_wheel.h"
+
+#define STACK_REPORT_PERIOD	CONFIG_APP_STACK_REPORT_PERIOD
 
 static struct k_work_q app_queue;
 
 struct k_work_q *_app_q = &app_queue;
 
+#if defined(CONFIG_APP_WQ_SINGLE_STACK)
+static struct k_work sys_q_stop;
+static K_SEM_DEFINE(sys_q_stopped, 0, 1);
+
+static void sys_q_stop_handler(struct k_work *work)
+{
+	/*
+	 * The system work queue thread is cooperative: giving the
+	 * semaphore does not switch away from it, so it is gone by the
+	 * time the waiter in app_wq_init() runs again.
+	 */
+	k_sem_give(&sys_q_stopped);
+	k_thread_abort(k_current_get());
+}
+#endif
+
 void app_wq_init(void)
 {
 	k_queue_init(&_app_q->queue);
+
+#if defined(CONFIG_APP_WQ_SINGLE_STACK)
+	/*
+	 * Make the system work queue thread stop itself, from a work
+	 * handler. Aborting it from here could catch it in k_poll(),
+	 * leaving its poll event registered on the queue, where it
+	 * would keep app_wq_run() from polling.
+	 *
+	 * Work already queued ahead of this item runs on the system
+	 * work queue thread; from here on, its queue is served by
+	 * app_wq_run().
+	 */
+	k_work_init(&sys_q_stop, sys_q_stop_handler);
+	k_work_submit(&sys_q_stop);
+	k_sem_take(&sys_q_stopped, K_FOREVER);
+#endif
+}
+
+static void app_wq_handle(struct k_work *work)
+{
+	k_work_handler_t handler = work->handler;
+
+	/* Reset pending state so it can be resubmitted by handler */
+	if (atomic_test_and_clear_bit(work->flags, K_WORK_STATE_PENDING)) {
+		handler(work);
+	}
 }
 
+#if defined(CONFIG_APP_WQ_SINGLE_STACK)
+void app_wq_run(void)
+{
+	/* Lanes, highest priority first */
+	struct k_queue *lanes[] = {
+		&k_sys_work_q.queue,
+		&_app_q->queue,
+	};
+	struct k_poll_event events[ARRAY_SIZE(lanes)];
+	struct k_work *work;
+	int i;
+
+	/* System work items expect to run with system work queue priority */
+	k_thread_priority_set(k_current_get(),
+			      CONFIG_SYSTEM_WORKQUEUE_PRIORITY);
+
+	for (i = 0; i < ARRAY_SIZE(lanes); i++) {
+		k_poll_event_init(&events[i], K_POLL_TYPE_FIFO_DATA_AVAILABLE,
+				  K_POLL_MODE_NOTIFY_ONLY, lanes[i]);
+	}
+
+	while (1) {
+		work = NULL;
+		for (i = 0; i < ARRAY_SIZE(lanes) && !work; i++) {
+			work = k_queue_get(lanes[i], K_NO_WAIT);
+		}
+
+		if (!work) {
+			k_poll(events, ARRAY_SIZE(events), K_FOREVER);
+			for (i = 0; i < ARRAY_SIZE(events); i++) {
+				events[i].state = K_POLL_STATE_NOT_READY;
+			}
+			continue;
+		}
+
+		app_wq_handle(work);
+
+		/* Make sure we don't hog up the CPU if the lanes never (or
+		 * very rarely) get empty.
+		 */
+		k_yield();
+	}
+}
+#else
 void app_wq_run(void)
 {
 	while (1) {
 		struct k_work *work;
-		k_work_handler_t handler;
 
 		work = k_queue_get(&_app_q->queue, K_FOREVER);
 
-		handler = work->handler;
-
-		/* Reset pending state so it can be resubmitted by handler */
-		if (atomic_test_and_clear_bit(work->flags,
-					       K_WORK_STATE_PENDING)) {
-			handler(work);
-		}
+		app_wq_handle(work);
 
 		/* Make sure we don't hog up the CPU if the QUEUE never (or
 		 * very rarely) gets empty.
@@ -51,3 +144,51 @@ void app_wq_run(void)
 		k_yield();
 	}
 }
+#endif
+
+#if defined(CONFIG_INIT_STACKS) && defined(CONFIG_THREAD_STACK_INFO)
+static struct wheel_timer stack_timer;
+
+/*
+ * High-water marks, only meaningful with initialized stacks. Wheel
+ * timers run on the thread serving app_wq_run(), which is main.
+ */
+static void stack_report(void)
+{
+	stack_analyze("main", (char *)k_current_get()->stack_info.start,
+		      k_current_get()->stack_info.size);
+#if !defined(CONFIG_APP_WQ_SINGLE_STACK)
+	stack_analyze("sysworkq", (char *)k_sys_work_q.thread.stack_info.start,
+		      k_sys_work_q.thread.stack_info.size);
+#endif
+}
+
+/*
+ * The marks at startup only cover initialization: report them again
+ * once mesh and application work (all of it on the main stack, in
+ * single stack mode) has run.
+ */
+static void stack_timer_handler(struct wheel_timer *timer)
+{
+	stack_report();
+	wheel_timer_arm(&stack_timer, STACK_REPORT_PERIOD,
+			STACK_REPORT_PERIOD / 8);
+}
+#endif
+
+void app_wq_ram_report(void)
+{
+	SYS_LOG_INF("%s mode, thread stacks: main %d, system work queue %d%s",
+		    IS_ENABLED(CONFIG_APP_WQ_SINGLE_STACK) ?
+		    "Single stack" : "Two stack",
+		    CONFIG_MAIN_STACK_SIZE, CONFIG_SYSTEM_WORKQUEUE_STACK_SIZE,
+		    IS_ENABLED(CONFIG_APP_WQ_SINGLE_STACK) ? " (unused)" : "");
+
+#if defined(CONFIG_INIT_STACKS) && defined(CONFIG_THREAD_STACK_INFO)
+	stack_report();
+
+	wheel_timer_init(&stack_timer, stack_timer_handler);
+	wheel_timer_arm(&stack_timer, STACK_REPORT_PERIOD,
+			STACK_REPORT_PERIOD / 8);
+#endif
+}
@@ -20,6 +20,10 @@
  *
  * Work may be submitted to this queue only by threads started from
  * main().
+ *
+ * With CONFIG_APP_WQ_SINGLE_STACK, the system work queue is served by
+ * the same thread, ahead of application work, and the system work
+ * queue thread is stopped.
  */
 
 #include <zephyr.h>
@@ -49,6 +53,16 @@ void app_wq_init(void);
 FUNC_NORETURN
 void app_wq_run(void);
 
+/**
+ * @brief Log the thread stack RAM used by the work queues.
+ *
+ * Stack high-water marks are included when CONFIG_INIT_STACKS and
+ * CONFIG_THREAD_STACK_INFO are enabled, and then logged again every
+ * CONFIG_APP_STACK_REPORT_PERIOD ms. Must be called after
+ * timer_wheel_init(), from the thread which then runs app_wq_run().
+ */
+void app_wq_ram_report(void);
+
 /**
  * @brief Submit work to the application work queue thread.
  * @param work Work to submit
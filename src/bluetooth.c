@@ -11,6 +11,7 @@
 #include <zephyr/types.h>
 #include <stddef.h>
 #include <errno.h>
+#include <string.h>
 #include <zephyr.h>
 #include <gpio.h>
 #include <misc/reboot.h>
@@ -22,6 +23,8 @@
 #include <bluetooth/hci.h>
 #include <bluetooth/storage.h>
 #include <bluetooth/conn.h>
+#include <bluetooth/gatt.h>
+#include <bluetooth/uuid.h>
 
 #include "product_id.h"
 
@@ -105,25 +108,249 @@ static void set_bluetooth_led(bool state)
 #endif
 }
 
+#if defined(CONFIG_APP_PROXY_PERF)
+/*
+ * Proxy performance mode: once a proxy client connects, ask for the
+ * shortest connection interval and exchange the MTU. Data length and
+ * 2M PHY updates are started by the host as soon as the controller
+ * supports them (see proxy-perf.conf).
+ */
+
+/* 7.5 to 15 ms interval, no latency, 4 s supervision timeout */
+#define PROXY_CONN_PARAM	BT_LE_CONN_PARAM(6, 12, 0, 400)
+
+struct proxy_conn_stats {
+	struct bt_conn *conn;	/* referenced while connected */
+	u32_t connected_at;
+	u32_t rx_bytes;		/* proxy and provisioning PDU bytes */
+	u32_t rx_pdus;
+	u16_t mtu;
+	u16_t interval;		/* 1.25 ms units */
+	u16_t latency;
+	u8_t param_updates;
+};
+
+static struct proxy_conn_stats proxy_stats[CONFIG_BT_MAX_CONN];
+static struct bt_gatt_exchange_params mtu_params[CONFIG_BT_MAX_CONN];
+
+static struct proxy_conn_stats *proxy_stats_find(struct bt_conn *conn)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(proxy_stats); i++) {
+		if (proxy_stats[i].conn == conn) {
+			return &proxy_stats[i];
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * The mesh stack owns the Proxy and Provisioning Data In
+ * characteristics, and calls no application code for the PDUs it
+ * receives on them. Their write handlers are wrapped when the first
+ * client connects, so PDUs are counted per connection before being
+ * passed on. Data Out notifications are sent from inside the stack
+ * with no such hook, and are not counted.
+ */
+typedef ssize_t (*gatt_write_t)(struct bt_conn *conn,
+				const struct bt_gatt_attr *attr,
+				const void *buf, u16_t len, u16_t offset,
+				u8_t flags);
+
+static struct {
+	const struct bt_gatt_attr *attr;
+	gatt_write_t write;
+} data_in[2];
+
+static ssize_t data_in_write(struct bt_conn *conn,
+			     const struct bt_gatt_attr *attr,
+			     const void *buf, u16_t len, u16_t offset,
+			     u8_t flags)
+{
+	struct proxy_conn_stats *stats = proxy_stats_find(conn);
+	int i;
+
+	if (stats) {
+		stats->rx_bytes += len;
+		stats->rx_pdus++;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(data_in); i++) {
+		if (data_in[i].attr == attr) {
+			return data_in[i].write(conn, attr, buf, len, offset,
+						flags);
+		}
+	}
+
+	return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
+}
+
+static u8_t data_in_wrap(const struct bt_gatt_attr *attr, void *user_data)
+{
+	struct bt_gatt_attr *writable = (struct bt_gatt_attr *)attr;
+	int i;
+
+	if (bt_uuid_cmp(attr->uuid, BT_UUID_MESH_PROXY_DATA_IN) &&
+	    bt_uuid_cmp(attr->uuid, BT_UUID_MESH_PROV_DATA_IN)) {
+		return BT_GATT_ITER_CONTINUE;
+	}
+
+	if (!attr->write || attr->write == data_in_write) {
+		return BT_GATT_ITER_CONTINUE;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(data_in); i++) {
+		if (!data_in[i].attr) {
+			data_in[i].attr = attr;
+			data_in[i].write = attr->write;
+			writable->write = data_in_write;
+			break;
+		}
+	}
+
+	return BT_GATT_ITER_CONTINUE;
+}
+
+static void mtu_exchanged(struct bt_conn *conn, u8_t err,
+			  struct bt_gatt_exchange_params *params)
+{
+	struct proxy_conn_stats *stats = proxy_stats_find(conn);
+
+	if (err) {
+		SYS_LOG_WRN("MTU exchange failed (err %u)", err);
+	}
+
+	if (stats) {
+		stats->mtu = bt_gatt_get_mtu(conn);
+		SYS_LOG_INF("Proxy MTU %u", stats->mtu);
+	}
+}
+
+static void proxy_perf_connected(struct bt_conn *conn)
+{
+	struct proxy_conn_stats *stats = proxy_stats_find(NULL);
+	struct bt_conn_info info;
+	int err;
+
+	if (!stats) {
+		return;
+	}
+
+	/*
+	 * Only the registered service is found: Provisioning before
+	 * provisioning, Proxy after. Wrapped handlers stay wrapped.
+	 */
+	bt_gatt_foreach_attr(0x0001, 0xffff, data_in_wrap, NULL);
+
+	memset(stats, 0, sizeof(*stats));
+	stats->conn = bt_conn_ref(conn);
+	stats->connected_at = k_uptime_get_32();
+	stats->mtu = bt_gatt_get_mtu(conn);
+
+	if (!bt_conn_get_info(conn, &info)) {
+		stats->interval = info.le.interval;
+		stats->latency = info.le.latency;
+	}
+
+	err = bt_conn_le_param_update(conn, PROXY_CONN_PARAM);
+	if (err) {
+		SYS_LOG_WRN("Connection parameter update failed (err %d)", err);
+	}
+
+	mtu_params[stats - proxy_stats].func = mtu_exchanged;
+	err = bt_gatt_exchange_mtu(conn, &mtu_params[stats - proxy_stats]);
+	if (err) {
+		SYS_LOG_WRN("MTU exchange failed (err %d)", err);
+	}
+}
+
+static void proxy_perf_disconnected(struct bt_conn *conn)
+{
+	struct proxy_conn_stats *stats = proxy_stats_find(conn);
+	u32_t duration, rx_rate = 0, capacity = 0;
+
+	if (!stats) {
+		return;
+	}
+
+	duration = k_uptime_get_32() - stats->connected_at;
+	if (duration) {
+		rx_rate = (u64_t)stats->rx_bytes * MSEC_PER_SEC / duration;
+	}
+
+	/* Link capacity: one full ATT PDU per connection event */
+	if (stats->interval) {
+		capacity = (stats->mtu - 3) * 800 / stats->interval;
+	}
+
+	SYS_LOG_INF("Proxy connection: %u ms, MTU %u, interval %u us, "
+		    "latency %u, %u param updates", duration, stats->mtu,
+		    stats->interval * 1250, stats->latency,
+		    stats->param_updates);
+	SYS_LOG_INF("Proxy received %u PDUs, %u bytes, %u B/s "
+		    "(capacity %u B/s)", stats->rx_pdus, stats->rx_bytes,
+		    rx_rate, capacity);
+
+	bt_conn_unref(stats->conn);
+	stats->conn = NULL;
+}
+
+static void le_param_updated(struct bt_conn *conn, u16_t interval,
+			     u16_t latency, u16_t timeout)
+{
+	struct proxy_conn_stats *stats = proxy_stats_find(conn);
+
+	SYS_LOG_DBG("Connection interval %u us, latency %u",
+		    interval * 1250, latency);
+
+	if (stats) {
+		stats->interval = interval;
+		stats->latency = latency;
+		stats->param_updates++;
+	}
+}
+#else
+static inline void proxy_perf_connected(struct bt_conn *conn)
+{
+}
+
+static inline void proxy_perf_disconnected(struct bt_conn *conn)
+{
+}
+#endif	/* CONFIG_APP_PROXY_PERF */
+
+/* The LED stays on while any client is connected */
+static atomic_t conn_count;
+
 static void connected(struct bt_conn *conn, u8_t err)
 {
 	if (err) {
 		SYS_LOG_ERR("BT LE Connection failed: %u", err);
 	} else {
 		SYS_LOG_INF("BT LE Connected");
+		atomic_inc(&conn_count);
 		set_bluetooth_led(1);
+		proxy_perf_connected(conn);
 	}
 }
 
 static void disconnected(struct bt_conn *conn, u8_t reason)
 {
 	SYS_LOG_INF("BT LE Disconnected (reason %u)", reason);
-	set_bluetooth_led(0);
+	proxy_perf_disconnected(conn);
+	if (atomic_dec(&conn_count) <= 1) {
+		set_bluetooth_led(0);
+	}
 }
 
 static struct bt_conn_cb conn_callbacks = {
 	.connected = connected,
 	.disconnected = disconnected,
+#if defined(CONFIG_APP_PROXY_PERF)
+	.le_param_updated = le_param_updated,
+#endif
 };
 
 static int bt_network_init(struct device *dev)
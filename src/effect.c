@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define SYS_LOG_DOMAIN "fota/effect"
+#define SYS_LOG_LEVEL CONFIG_SYS_LOG_FOTA_LEVEL
+#include <logging/sys_log.h>
+
+#include <string.h>
+#include <zephyr.h>
+
+#include "timer_wheel.h"
+#include "effect.h"
+
+#define EFFECT_TICK		CONFIG_APP_EFFECT_TICK
+
+/* Triangle shapes are approximated with this many steps */
+#define EFFECT_MAX_STEPS	16
+
+enum effect_shape {
+	EFFECT_SHAPE_SQUARE,
+	EFFECT_SHAPE_TRIANGLE,
+};
+
+struct effect_desc {
+	u8_t shape;
+	u8_t high;		/* percentage of the base level */
+	u8_t low;
+	u8_t duty;		/* square only, percentage of the period */
+	u16_t period_ms;
+	u8_t repeat;		/* 0 is forever */
+};
+
+static const struct effect_desc effect_descs[EFFECT_COUNT] = {
+	[EFFECT_BLINK] = {
+		.shape = EFFECT_SHAPE_SQUARE, .high = 100, .low = 0,
+		.duty = 50, .period_ms = 400,
+	},
+	[EFFECT_BREATHE] = {
+		.shape = EFFECT_SHAPE_TRIANGLE, .high = 100, .low = 10,
+		.period_ms = 2000,
+	},
+	[EFFECT_STROBE] = {
+		.shape = EFFECT_SHAPE_SQUARE, .high = 100, .low = 0,
+		.duty = 10, .period_ms = 100,
+	},
+	[EFFECT_IDENTIFY] = {
+		.shape = EFFECT_SHAPE_SQUARE, .high = 100, .low = 0,
+		.duty = 50, .period_ms = 1000, .repeat = 10,
+	},
+	[EFFECT_PROVISIONED] = {
+		.shape = EFFECT_SHAPE_SQUARE, .high = 100, .low = 0,
+		.duty = 50, .period_ms = 2000,
+	},
+};
+
+struct effect_step {
+	u8_t level;
+	u8_t ticks;
+};
+
+struct effect_table {
+	u8_t count;
+	u8_t repeat;
+	struct effect_step steps[EFFECT_MAX_STEPS];
+};
+
+struct effect_player {
+	const struct effect_table *table;
+	u32_t next_ms;		/* uptime at which the step ends */
+	u8_t step;
+	u8_t repeat_left;
+	u8_t scale;
+	u8_t base;
+	u8_t last;		/* last level emitted */
+};
+
+static struct effect_table effect_tables[EFFECT_COUNT];
+static struct effect_player players[EFFECT_CHANNELS];
+static const struct effect_backend *effect_backend;
+static struct wheel_timer ticker;
+static u8_t active_count;
+
+static u8_t ms_to_ticks(u32_t ms)
+{
+	return max(1, min(255, ms / EFFECT_TICK));
+}
+
+static void effect_compile(const struct effect_desc *desc,
+			   struct effect_table *table)
+{
+	u32_t on_ms;
+	int half, i;
+
+	table->repeat = desc->repeat;
+
+	switch (desc->shape) {
+	case EFFECT_SHAPE_SQUARE:
+		on_ms = desc->period_ms * desc->duty / 100;
+		table->steps[0].level = desc->high;
+		table->steps[0].ticks = ms_to_ticks(on_ms);
+		table->steps[1].level = desc->low;
+		table->steps[1].ticks = ms_to_ticks(desc->period_ms - on_ms);
+		table->count = 2;
+		break;
+	case EFFECT_SHAPE_TRIANGLE:
+		half = EFFECT_MAX_STEPS / 2;
+		for (i = 0; i < half; i++) {
+			table->steps[i].level = desc->low +
+				(desc->high - desc->low) * i / (half - 1);
+			table->steps[EFFECT_MAX_STEPS - 1 - i].level =
+				table->steps[i].level;
+		}
+		for (i = 0; i < EFFECT_MAX_STEPS; i++) {
+			table->steps[i].ticks =
+				ms_to_ticks(desc->period_ms / EFFECT_MAX_STEPS);
+		}
+		table->count = EFFECT_MAX_STEPS;
+		break;
+	}
+}
+
+static void effect_emit(u8_t channel, u8_t level)
+{
+	struct effect_player *player = &players[channel];
+
+	if (level == player->last) {
+		return;
+	}
+
+	player->last = level;
+	if (effect_backend->set(channel, level)) {
+		SYS_LOG_ERR("Failed to set channel %d to %d", channel, level);
+	}
+}
+
+static void effect_enter_step(struct effect_player *player, u8_t channel)
+{
+	const struct effect_step *step = &player->table->steps[player->step];
+
+	player->next_ms += step->ticks * player->scale * EFFECT_TICK;
+	effect_emit(channel, step->level * player->base / 100);
+}
+
+static void effect_stop(struct effect_player *player)
+{
+	if (player->table) {
+		player->table = NULL;
+		if (!--active_count) {
+			wheel_timer_cancel(&ticker);
+		}
+	}
+}
+
+/*
+ * The ticker is armed for the end of the earliest step, rather than
+ * every tick: a slow effect, like the provisioned heartbeat, only wakes
+ * the node up when its level changes.
+ */
+static void ticker_schedule(u32_t now)
+{
+	s32_t delay, next = -1;
+	u8_t ch;
+
+	for (ch = 0; ch < EFFECT_CHANNELS; ch++) {
+		if (!players[ch].table) {
+			continue;
+		}
+
+		delay = players[ch].next_ms - now;
+		if (next < 0 || delay < next) {
+			next = delay;
+		}
+	}
+
+	if (next >= 0) {
+		wheel_timer_arm(&ticker, max(1, next), 0);
+	}
+}
+
+/*
+ * Players are driven both from the ticker (application work queue) and
+ * from mesh model handlers: the scheduler is locked while they run, so
+ * levels are never emitted concurrently.
+ */
+static void ticker_handler(struct wheel_timer *timer)
+{
+	struct effect_player *player;
+	u32_t now = k_uptime_get_32();
+	u8_t ch;
+
+	k_sched_lock();
+
+	for (ch = 0; ch < EFFECT_CHANNELS; ch++) {
+		player = &players[ch];
+
+		/* Step ends are kept on the original grid when late */
+		while (player->table && (s32_t)(now - player->next_ms) >= 0) {
+			if (++player->step == player->table->count) {
+				player->step = 0;
+
+				if (player->repeat_left &&
+				    !--player->repeat_left) {
+					effect_stop(player);
+					effect_emit(ch, player->base);
+					break;
+				}
+			}
+
+			effect_enter_step(player, ch);
+		}
+	}
+
+	ticker_schedule(now);
+
+	k_sched_unlock();
+}
+
+void effect_play(u8_t channel, u8_t id, u8_t base, u8_t scale)
+{
+	struct effect_player *player;
+	u32_t now;
+
+	if (channel >= EFFECT_CHANNELS || id >= EFFECT_COUNT) {
+		return;
+	}
+
+	k_sched_lock();
+
+	player = &players[channel];
+	if (!player->table) {
+		active_count++;
+	}
+
+	now = k_uptime_get_32();
+
+	player->table = &effect_tables[id];
+	player->step = 0;
+	player->repeat_left = player->table->repeat;
+	player->scale = max(1, scale);
+	player->base = base;
+	player->next_ms = now;
+
+	effect_enter_step(player, channel);
+	ticker_schedule(now);
+
+	k_sched_unlock();
+}
+
+void effect_set(u8_t channel, u8_t level)
+{
+	if (channel >= EFFECT_CHANNELS) {
+		return;
+	}
+
+	k_sched_lock();
+
+	effect_stop(&players[channel]);
+	players[channel].base = level;
+	effect_emit(channel, level);
+
+	k_sched_unlock();
+}
+
+void effect_init(const struct effect_backend *backend)
+{
+	int i;
+
+	effect_backend = backend;
+
+	for (i = 0; i < EFFECT_COUNT; i++) {
+		effect_compile(&effect_descs[i], &effect_tables[i]);
+	}
+
+	wheel_timer_init(&ticker, ticker_handler);
+}
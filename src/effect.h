@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __FOTA_EFFECT_H__
+#define __FOTA_EFFECT_H__
+
+/**
+ * @file
+ * @brief Light effect engine
+ *
+ * Effects (blink, breathe, ...) are described by compact descriptors,
+ * compiled once at init time into tables of (level, duration) steps.
+ * A single ticker plays the tables back on every channel, so the cost
+ * per tick is fixed and nothing is scheduled per edge.
+ *
+ * Levels are emitted through a backend, which maps channels to the
+ * actual hardware (or to a recorder, in tools/replay/effect_test.c).
+ */
+
+#include <zephyr/types.h>
+
+/* Light channels */
+enum effect_channel {
+	EFFECT_CH_WHITE,	/* dimmable white PWM */
+	EFFECT_CH_STATUS,	/* on/off status LED */
+
+	EFFECT_CHANNELS,
+};
+
+/* Effects, see effect_descs[] */
+enum effect_id {
+	EFFECT_BLINK,		/* 400 ms period, 50% duty */
+	EFFECT_BREATHE,		/* 2 s triangle ramp */
+	EFFECT_STROBE,		/* 100 ms period, 10% duty */
+	EFFECT_IDENTIFY,	/* 1 s period, 50% duty, 10 times */
+	EFFECT_PROVISIONED,	/* 2 s period, 50% duty */
+
+	EFFECT_COUNT,
+};
+
+/**
+ * @brief Effect backend
+ */
+struct effect_backend {
+	/**
+	 * @brief Set a channel level.
+	 * @param channel Channel, see enum effect_channel.
+	 * @param level   Level, 0 (off) to 100.
+	 * @return 0 on success, negative errno otherwise.
+	 */
+	int (*set)(u8_t channel, u8_t level);
+};
+
+/**
+ * @brief Compile the effect tables and register the backend.
+ *
+ * Must be called after timer_wheel_init().
+ *
+ * @param backend Backend used to emit levels.
+ */
+void effect_init(const struct effect_backend *backend);
+
+/**
+ * @brief Play an effect on a channel, replacing the current one.
+ *
+ * Effect levels are relative to @a base: an effect step at 100% emits
+ * @a base. When a finite effect ends, the channel is left at @a base.
+ *
+ * @param channel Channel to play on.
+ * @param id      Effect to play.
+ * @param base    Base level, 0 to 100.
+ * @param scale   Time scale factor, 1 plays at nominal speed.
+ */
+void effect_play(u8_t channel, u8_t id, u8_t base, u8_t scale);
+
+/**
+ * @brief Set a steady level, stopping any effect on the channel.
+ * @param channel Channel.
+ * @param level   Level, 0 to 100.
+ */
+void effect_set(u8_t channel, u8_t level);
+
+#endif	/* __FOTA_EFFECT_H__ */
@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define SYS_LOG_DOMAIN "fota/health"
+#define SYS_LOG_LEVEL CONFIG_SYS_LOG_FOTA_LEVEL
+#include <logging/sys_log.h>
+
+#include <errno.h>
+#include <zephyr.h>
+
+#include "app_work_queue.h"
+#include "timer_wheel.h"
+#include "mesh_models.h"
+#include "mcuboot.h"
+#include "health.h"
+
+#define FAULT_BASE	HEALTH_FAULT_REPLY_EXHAUSTED
+#define FAULT_COUNT	(HEALTH_FAULT_END - FAULT_BASE)
+
+#define FAULT_HOLD	CONFIG_APP_HEALTH_FAULT_HOLD
+
+static const struct health_ops *health_ops;
+
+/* Bit n stands for fault FAULT_BASE + n */
+static atomic_t current;
+static atomic_t registered;
+static u32_t last_trip[FAULT_COUNT];
+static u8_t last_test_id = HEALTH_TEST_ID;
+
+/* Publication is triggered from the work queue, raise may be an ISR */
+static struct k_work update_work;
+static struct wheel_timer hold_timer;
+
+static u8_t fault_list(atomic_t *set, u8_t *faults, u8_t max)
+{
+	atomic_val_t bits = atomic_get(set);
+	u8_t count = 0;
+	int i;
+
+	for (i = 0; i < FAULT_COUNT && count < max; i++) {
+		if (bits & BIT(i)) {
+			faults[count++] = FAULT_BASE + i;
+		}
+	}
+
+	return count;
+}
+
+static void fault_publish(void)
+{
+	int err;
+
+	if (!health_srv.model) {
+		/* Mesh not initialized yet */
+		return;
+	}
+
+	err = bt_mesh_fault_update(bt_mesh_model_elem(health_srv.model));
+	if (err && err != -EADDRNOTAVAIL) {
+		SYS_LOG_ERR("Unable to publish health status (err %d)", err);
+	}
+}
+
+/* Drop faults which did not trip for FAULT_HOLD ms */
+static void hold_handler(struct wheel_timer *timer)
+{
+	u32_t now = k_uptime_get_32();
+	u32_t next = FAULT_HOLD;
+	u32_t age;
+	bool changed = false;
+	int i;
+
+	for (i = 0; i < FAULT_COUNT; i++) {
+		if (!atomic_test_bit(&current, i)) {
+			continue;
+		}
+
+		age = now - last_trip[i];
+		if (age >= FAULT_HOLD) {
+			atomic_clear_bit(&current, i);
+			SYS_LOG_INF("Fault 0x%02x cleared", FAULT_BASE + i);
+			changed = true;
+		} else {
+			next = min(next, FAULT_HOLD - age);
+		}
+	}
+
+	if (atomic_get(&current)) {
+		wheel_timer_arm(&hold_timer, next, next / 4);
+	}
+
+	if (changed) {
+		fault_publish();
+	}
+}
+
+static void update_handler(struct k_work *work)
+{
+	fault_publish();
+
+	if (!wheel_timer_is_armed(&hold_timer)) {
+		wheel_timer_arm(&hold_timer, FAULT_HOLD, FAULT_HOLD / 4);
+	}
+}
+
+void health_fault_raise(u8_t fault)
+{
+	u8_t bit = fault - FAULT_BASE;
+
+	if (fault < FAULT_BASE || bit >= FAULT_COUNT) {
+		return;
+	}
+
+	last_trip[bit] = k_uptime_get_32();
+	atomic_set_bit(&registered, bit);
+
+	if (!atomic_test_and_set_bit(&current, bit)) {
+		/* Newly current: publish without waiting for the period */
+		app_wq_submit(&update_work);
+	}
+}
+
+void health_wq_latency(u32_t us)
+{
+	if (us > CONFIG_APP_WQ_LATENCY_BUDGET) {
+		health_fault_raise(HEALTH_FAULT_WQ_LATENCY);
+	}
+}
+
+void health_flash_erased(u32_t len, u32_t elapsed_ms)
+{
+	/* Budget is per KB, rounded up */
+	u32_t budget_ms = CONFIG_APP_FLASH_ERASE_BUDGET * ((len + 1023) / 1024);
+
+	if (elapsed_ms > budget_ms) {
+		SYS_LOG_WRN("Flash erase of %u bytes took %u ms",
+			    len, elapsed_ms);
+		health_fault_raise(HEALTH_FAULT_FLASH_STALL);
+	}
+}
+
+/* Overrides the default hook of lib/mcuboot.c */
+void boot_flash_erased(u32_t len, u32_t elapsed_ms)
+{
+	health_flash_erased(len, elapsed_ms);
+}
+
+/* Health model callbacks */
+
+static int fault_get_cur(struct bt_mesh_model *model, u8_t *test_id,
+			 u16_t *company_id, u8_t *faults, u8_t *fault_count)
+{
+	*test_id = last_test_id;
+	*company_id = CID_NORDIC;
+	*fault_count = fault_list(&current, faults, *fault_count);
+
+	return 0;
+}
+
+static int fault_get_reg(struct bt_mesh_model *model, u16_t company_id,
+			 u8_t *test_id, u8_t *faults, u8_t *fault_count)
+{
+	if (company_id != CID_NORDIC) {
+		return -EINVAL;
+	}
+
+	*test_id = last_test_id;
+	*fault_count = fault_list(&registered, faults, *fault_count);
+
+	return 0;
+}
+
+static int fault_clear(struct bt_mesh_model *model, u16_t company_id)
+{
+	if (company_id != CID_NORDIC) {
+		return -EINVAL;
+	}
+
+	atomic_clear(&registered);
+
+	return 0;
+}
+
+static int fault_test(struct bt_mesh_model *model, u8_t test_id,
+		      u16_t company_id)
+{
+	u32_t latency_us;
+	int err;
+
+	if (company_id != CID_NORDIC || test_id != HEALTH_TEST_ID) {
+		return -EINVAL;
+	}
+
+	if (!health_ops || !health_ops->self_test) {
+		return -ENOTSUP;
+	}
+
+	err = health_ops->self_test(&latency_us);
+	if (err) {
+		SYS_LOG_ERR("Self-test failed (err %d)", err);
+		return err;
+	}
+
+	last_test_id = test_id;
+
+	SYS_LOG_INF("Self-test: set to PWM latency %u us (budget %u us)",
+		    latency_us, CONFIG_APP_SET_LATENCY_BUDGET);
+	if (latency_us > CONFIG_APP_SET_LATENCY_BUDGET) {
+		health_fault_raise(HEALTH_FAULT_SET_LATENCY);
+	}
+
+	return 0;
+}
+
+static void attention_on(struct bt_mesh_model *model)
+{
+	if (health_ops && health_ops->attention) {
+		health_ops->attention(true);
+	}
+}
+
+static void attention_off(struct bt_mesh_model *model)
+{
+	if (health_ops && health_ops->attention) {
+		health_ops->attention(false);
+	}
+}
+
+struct bt_mesh_health health_srv = {
+	.fault_get_cur = fault_get_cur,
+	.fault_get_reg = fault_get_reg,
+	.fault_clear = fault_clear,
+	.fault_test = fault_test,
+	.attn_on = attention_on,
+	.attn_off = attention_off,
+};
+
+void health_init(const struct health_ops *ops)
+{
+	health_ops = ops;
+
+	k_work_init(&update_work, update_handler);
+	wheel_timer_init(&hold_timer, hold_handler);
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __FOTA_HEALTH_H__
+#define __FOTA_HEALTH_H__
+
+/**
+ * @file
+ * @brief Health Server with performance faults
+ *
+ * Performance pathologies are reported as vendor specific fault codes
+ * of the Health model, so overloaded nodes show up in any standard
+ * provisioner or configuration tool.
+ *
+ * A fault is current while it keeps tripping, and for
+ * CONFIG_APP_HEALTH_FAULT_HOLD ms after that. Every fault which was
+ * ever current is also registered, until a Health Fault Clear. A new
+ * current fault triggers an immediate health publication; while any
+ * fault is current, the stack publishes at the fast period set with
+ * Health Period Set.
+ */
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <bluetooth/mesh.h>
+
+/* Vendor specific fault codes (0x80 - 0xff) */
+enum health_fault {
+	HEALTH_FAULT_REPLY_EXHAUSTED = 0x80,	/* reply pool exhausted */
+	HEALTH_FAULT_ADV_STARVED,	/* no advertising buffer to send */
+	HEALTH_FAULT_WQ_LATENCY,	/* work queue latency over budget */
+	HEALTH_FAULT_FLASH_STALL,	/* flash erase slower than budget */
+	HEALTH_FAULT_LOG_DROP,		/* log lines dropped, see APP_LOG_RATE */
+	HEALTH_FAULT_SET_LATENCY,	/* self-test set to PWM over budget */
+
+	HEALTH_FAULT_END,
+};
+
+/* Self-test run on Health Fault Test with test ID 0 */
+#define HEALTH_TEST_ID	0
+
+/**
+ * @brief Application hooks for the Health Server
+ */
+struct health_ops {
+	/**
+	 * @brief Turn the attention indication on or off.
+	 * @param on true when the attention timer starts.
+	 */
+	void (*attention)(bool on);
+
+	/**
+	 * @brief Run the self-test.
+	 * @param latency_us Worst set to PWM latency measured, in us.
+	 * @return 0 on success, negative errno if the test could not run.
+	 */
+	int (*self_test)(u32_t *latency_us);
+};
+
+/** Health Server model data, for the composition */
+extern struct bt_mesh_health health_srv;
+
+/**
+ * @brief Register the application hooks.
+ *
+ * Must be called after timer_wheel_init().
+ *
+ * @param ops Application hooks.
+ */
+void health_init(const struct health_ops *ops);
+
+/**
+ * @brief Report a fault occurrence.
+ *
+ * May be called from any context, including interrupts.
+ *
+ * @param fault Fault code, see enum health_fault.
+ */
+void health_fault_raise(u8_t fault);
+
+/**
+ * @brief Report a work queue latency sample.
+ * @param us Time an item waited for the work queue, in us.
+ */
+void health_wq_latency(u32_t us);
+
+/**
+ * @brief Report a completed flash erase.
+ * @param len        Number of bytes erased.
+ * @param elapsed_ms Time the erase took, in ms.
+ */
+void health_flash_erased(u32_t len, u32_t elapsed_ms);
+
+#endif	/* __FOTA_HEALTH_H__ */
@@ -0,0 +1,313 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define SYS_LOG_DOMAIN "fota/verify"
+#define SYS_LOG_LEVEL CONFIG_SYS_LOG_FOTA_LEVEL
+#include <logging/sys_log.h>
+
+#include <stddef.h>
+#include <errno.h>
+#include <string.h>
+#include <flash.h>
+#include <zephyr.h>
+
+#include <tinycrypt/constants.h>
+#include <tinycrypt/sha256.h>
+
+#include "mcuboot.h"
+#include "image_verify.h"
+
+/*
+ * Image layout, as defined by mcuboot/imgtool: a fixed header,
+ * padded to ih_hdr_size, followed by the image body and then by a
+ * TLV area. The SHA-256 TLV covers header and body; it is also what
+ * the signature TLV signs.
+ */
+
+#define IMAGE_MAGIC		0x96f3b83c
+#define IMAGE_TLV_INFO_MAGIC	0x6907
+#define IMAGE_TLV_SHA256	0x10
+
+__packed
+struct image_header {
+	u32_t ih_magic;
+	u32_t ih_load_addr;
+	u16_t ih_hdr_size;
+	u16_t ih_pad1;
+	u32_t ih_img_size;
+	u32_t ih_flags;
+	u8_t ih_ver[8];
+	u32_t ih_pad2;
+};
+
+__packed
+struct image_tlv_info {
+	u16_t it_magic;
+	u16_t it_tlv_tot;
+};
+
+__packed
+struct image_tlv {
+	u8_t it_type;
+	u8_t it_pad;
+	u16_t it_len;
+};
+
+/* Flash is re-read in chunks of this size ... */
+#define VERIFY_CHUNK_SIZE	256
+/* ... and this many chunks are hashed per work queue run. */
+#define VERIFY_CHUNKS_PER_RUN	4
+
+enum verify_state {
+	VERIFY_IDLE,
+	VERIFY_HASHING,
+	VERIFY_DONE,
+	VERIFY_BROKEN,
+};
+
+static struct {
+	struct tc_sha256_state_struct sha;
+	struct image_header hdr;
+	u32_t offset;		/* next byte expected */
+	u32_t hash_len;		/* header + body, once header is known */
+	u32_t hash_cycles;	/* time spent hashing */
+	u32_t start_ms;
+	u8_t digest[TC_SHA256_DIGEST_SIZE];
+	u8_t state;
+} verify;
+
+/* Deferred (flash re-read) verification */
+static struct k_work flash_work;
+static u32_t flash_bank;
+static image_verify_cb_t flash_cb;
+static u8_t flash_chunk[VERIFY_CHUNK_SIZE];
+
+void __weak image_verify_submit(struct k_work *work)
+{
+	k_work_submit(work);
+}
+
+static void hash_reset(void)
+{
+	memset(&verify, 0, sizeof(verify));
+	tc_sha256_init(&verify.sha);
+	verify.state = VERIFY_HASHING;
+	verify.start_ms = k_uptime_get_32();
+}
+
+static void hash_report(void)
+{
+	u32_t us = SYS_CLOCK_HW_CYCLES_TO_NS64(verify.hash_cycles) /
+		   NSEC_PER_USEC;
+	u32_t kb = verify.hash_len / 1024;
+
+	SYS_LOG_INF("Hashed %u bytes in %u us (%u us/KB), %u ms elapsed",
+		    verify.hash_len, us, kb ? us / kb : us,
+		    k_uptime_get_32() - verify.start_ms);
+}
+
+/*
+ * Hash the next bytes of the image, which must start at
+ * verify.offset. Bytes past the end of the hashed area (i.e. the
+ * TLVs) are ignored.
+ */
+static void hash_feed(const u8_t *data, size_t len)
+{
+	u32_t start;
+	size_t n;
+
+	while (len && verify.state == VERIFY_HASHING) {
+		if (verify.offset < sizeof(verify.hdr)) {
+			n = min(len, sizeof(verify.hdr) - verify.offset);
+			memcpy((u8_t *)&verify.hdr + verify.offset, data, n);
+
+			if (verify.offset + n == sizeof(verify.hdr)) {
+				if (verify.hdr.ih_magic != IMAGE_MAGIC ||
+				    verify.hdr.ih_hdr_size <
+				    sizeof(verify.hdr)) {
+					SYS_LOG_ERR("Bad image header");
+					verify.state = VERIFY_BROKEN;
+					break;
+				}
+
+				verify.hash_len = verify.hdr.ih_hdr_size +
+						  verify.hdr.ih_img_size;
+				if (verify.hash_len > FLASH_BANK_SIZE) {
+					SYS_LOG_ERR("Image too large");
+					verify.state = VERIFY_BROKEN;
+					break;
+				}
+			}
+		} else {
+			n = min(len, verify.hash_len - verify.offset);
+		}
+
+		start = k_cycle_get_32();
+		tc_sha256_update(&verify.sha, data, n);
+		verify.hash_cycles += k_cycle_get_32() - start;
+
+		verify.offset += n;
+		data += n;
+		len -= n;
+
+		if (verify.hash_len && verify.offset == verify.hash_len) {
+			tc_sha256_final(verify.digest, &verify.sha);
+			verify.state = VERIFY_DONE;
+			hash_report();
+		}
+	}
+}
+
+/* Compare the computed digest with the image's SHA-256 TLV */
+static int tlv_check(u32_t bank_offset)
+{
+	struct image_tlv_info info;
+	struct image_tlv tlv;
+	u8_t hash[TC_SHA256_DIGEST_SIZE];
+	u32_t off, end;
+
+	off = bank_offset + verify.hash_len;
+	if (verify.hash_len + sizeof(info) > FLASH_BANK_SIZE ||
+	    flash_read(flash_dev, off, &info, sizeof(info))) {
+		return -EIO;
+	}
+
+	if (info.it_magic != IMAGE_TLV_INFO_MAGIC) {
+		SYS_LOG_ERR("No TLV area found after the image");
+		return -ENOENT;
+	}
+
+	end = off + info.it_tlv_tot;
+	if (end > bank_offset + FLASH_BANK_SIZE) {
+		return -EBADMSG;
+	}
+
+	for (off += sizeof(info); off + sizeof(tlv) <= end;
+	     off += sizeof(tlv) + tlv.it_len) {
+		if (flash_read(flash_dev, off, &tlv, sizeof(tlv))) {
+			return -EIO;
+		}
+
+		if (tlv.it_type != IMAGE_TLV_SHA256) {
+			continue;
+		}
+
+		if (tlv.it_len != sizeof(hash) ||
+		    flash_read(flash_dev, off + sizeof(tlv), hash,
+			       sizeof(hash))) {
+			return -EBADMSG;
+		}
+
+		if (memcmp(hash, verify.digest, sizeof(hash))) {
+			SYS_LOG_ERR("Image hash mismatch");
+			return -EBADMSG;
+		}
+
+		SYS_LOG_INF("Image hash verified");
+		return 0;
+	}
+
+	SYS_LOG_ERR("No SHA-256 TLV found");
+	return -ENOENT;
+}
+
+void image_verify_start(void)
+{
+	hash_reset();
+}
+
+void image_verify_update(u32_t offset, const u8_t *data, size_t len)
+{
+	if (verify.state != VERIFY_HASHING) {
+		return;
+	}
+
+	if (offset != verify.offset) {
+		SYS_LOG_WRN("Out of order chunk at %u (expected %u)",
+			    offset, verify.offset);
+		verify.state = VERIFY_BROKEN;
+		return;
+	}
+
+	hash_feed(data, len);
+}
+
+int image_verify_check(u32_t bank_offset)
+{
+	if (verify.state != VERIFY_DONE) {
+		return -EAGAIN;
+	}
+
+	return tlv_check(bank_offset);
+}
+
+static void flash_verify_handler(struct k_work *work)
+{
+	image_verify_cb_t cb;
+	u32_t len;
+	int i;
+	int ret;
+
+	for (i = 0; i < VERIFY_CHUNKS_PER_RUN; i++) {
+		/* Until the header is known, only read the header */
+		if (verify.hash_len) {
+			len = min(sizeof(flash_chunk),
+				  verify.hash_len - verify.offset);
+		} else {
+			len = sizeof(verify.hdr) - verify.offset;
+		}
+
+		if (verify.offset + len > FLASH_BANK_SIZE) {
+			verify.state = VERIFY_BROKEN;
+		} else if (flash_read(flash_dev, flash_bank + verify.offset,
+				      flash_chunk, len)) {
+			SYS_LOG_ERR("Flash read failed at %u", verify.offset);
+			verify.state = VERIFY_BROKEN;
+		} else {
+			hash_feed(flash_chunk, len);
+		}
+
+		if (verify.state != VERIFY_HASHING) {
+			break;
+		}
+	}
+
+	if (verify.state == VERIFY_HASHING) {
+		/* Yield to other work, continue on the next run */
+		image_verify_submit(&flash_work);
+		return;
+	}
+
+	if (verify.state == VERIFY_DONE) {
+		ret = tlv_check(flash_bank);
+	} else {
+		ret = -EBADMSG;
+	}
+
+	cb = flash_cb;
+	flash_cb = NULL;
+	cb(ret);
+}
+
+int image_verify_flash(u32_t bank_offset, image_verify_cb_t cb)
+{
+	if (!cb) {
+		return -EINVAL;
+	}
+
+	if (flash_cb) {
+		return -EBUSY;
+	}
+
+	hash_reset();
+	flash_bank = bank_offset;
+	flash_cb = cb;
+
+	k_work_init(&flash_work, flash_verify_handler);
+	image_verify_submit(&flash_work);
+
+	return 0;
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __FOTA_IMAGE_VERIFY_H__
+#define __FOTA_IMAGE_VERIFY_H__
+
+/**
+ * @file
+ * @brief SHA-256 verification of the update image.
+ *
+ * The image hash (mcuboot header plus image body) is computed
+ * incrementally while the image is written to flash, so it is ready
+ * as soon as the last byte lands. If the stream was not seen in full
+ * (e.g. the transfer resumed after a reboot), the hash is computed
+ * instead by re-reading the flash bank in small chunks from a work
+ * queue (see image_verify_submit()).
+ *
+ * Either way, the digest is compared against the SHA-256 TLV that
+ * imgtool appends (and signs) after the image, before the bootloader
+ * is ever asked to swap.
+ */
+
+#include <zephyr.h>
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <errno.h>
+
+/**
+ * @brief Callback invoked when a deferred verification completes.
+ * @param result 0 if the image hash matches, negative errno otherwise.
+ */
+typedef void (*image_verify_cb_t)(int result);
+
+#ifndef CONFIG_FOTA_IMAGE_VERIFY
+static inline void image_verify_start(void)
+{
+}
+
+static inline void image_verify_update(u32_t offset, const u8_t *data,
+				       size_t len)
+{
+}
+
+static inline int image_verify_check(u32_t bank_offset)
+{
+	return 0;
+}
+
+static inline int image_verify_flash(u32_t bank_offset,
+				     image_verify_cb_t cb)
+{
+	return -ENOTSUP;
+}
+#else
+/**
+ * @brief Reset the streaming hash for a new transfer.
+ *
+ * Must be called before the first byte of a new image is written.
+ */
+void image_verify_start(void);
+
+/**
+ * @brief Feed a chunk which was just written to the update bank.
+ *
+ * Chunks must arrive in order; a gap or overlap invalidates the
+ * streaming hash, and image_verify_check() then reports -EAGAIN.
+ *
+ * @param offset Offset of the chunk relative to the start of the bank.
+ * @param data   Chunk data.
+ * @param len    Chunk length in bytes.
+ */
+void image_verify_update(u32_t offset, const u8_t *data, size_t len);
+
+/**
+ * @brief Check the streamed hash against the image's SHA-256 TLV.
+ *
+ * @param bank_offset Flash offset of the bank holding the image.
+ * @return 0 on match, -EAGAIN if the streamed hash is not complete,
+ *         -EBADMSG on mismatch, -ENOENT if the image has no hash TLV.
+ */
+int image_verify_check(u32_t bank_offset);
+
+/**
+ * @brief Verify the image by re-reading it from flash.
+ *
+ * Hashing is split in chunks, each one processed by a separate run
+ * of a work item submitted with image_verify_submit(), so other work
+ * is not starved and no image-sized RAM buffer is needed.
+ *
+ * @param bank_offset Flash offset of the bank holding the image.
+ * @param cb          Called from the work queue with the result.
+ * @return 0 if verification was scheduled, -EBUSY if one is running,
+ *         -EINVAL if no callback was given.
+ */
+int image_verify_flash(u32_t bank_offset, image_verify_cb_t cb);
+
+/**
+ * @brief Work queue hook for deferred verification.
+ *
+ * Submits a verification work item. The default implementation uses
+ * the system work queue; applications may override it to run the
+ * hashing on a queue of their own.
+ *
+ * @param work Work item to submit.
+ */
+void image_verify_submit(struct k_work *work);
+#endif	/* !defined(CONFIG_FOTA_IMAGE_VERIFY) */
+
+#endif	/* __FOTA_IMAGE_VERIFY_H__ */
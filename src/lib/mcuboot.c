@@ -16,6 +16,7 @@
 #include <init.h>
 
 #include "mcuboot.h"
+#include "image_verify.h"
 #include "product_id.h"
 
 /*
@@ -93,7 +94,7 @@ void boot_status_update(void)
 	}
 }
 
-void boot_trigger_ota(void)
+static void boot_arm_swap(void)
 {
 	u32_t copy_done_offset, image_ok_offset;
 	struct boot_copy_done cd;
@@ -113,14 +114,77 @@ void boot_trigger_ota(void)
 	flash_write_protection_set(flash_dev, true);
 }
 
+static void boot_verified(int result)
+{
+	if (result) {
+		SYS_LOG_ERR("Image verification failed (err %d)", result);
+		return;
+	}
+
+	boot_arm_swap();
+}
+
+int boot_trigger_ota(void)
+{
+	int ret;
+
+	ret = image_verify_check(FLASH_AREA_IMAGE_1_OFFSET);
+	if (ret == -EAGAIN) {
+		SYS_LOG_INF("Image not streamed in full, re-reading flash");
+		ret = image_verify_flash(FLASH_AREA_IMAGE_1_OFFSET,
+					 boot_verified);
+		return ret ? ret : -EINPROGRESS;
+	}
+
+	if (ret) {
+		SYS_LOG_ERR("Image verification failed (err %d)", ret);
+		return ret;
+	}
+
+	boot_arm_swap();
+
+	return 0;
+}
+
+void __weak boot_flash_erased(u32_t len, u32_t elapsed_ms)
+{
+}
+
 int boot_erase_flash_bank(u32_t bank_offset)
 {
+	u32_t start = k_uptime_get_32();
 	int ret;
 
 	flash_write_protection_set(flash_dev, false);
 	ret = flash_erase(flash_dev, bank_offset, FLASH_BANK_SIZE);
 	flash_write_protection_set(flash_dev, true);
 
+	if (!ret) {
+		boot_flash_erased(FLASH_BANK_SIZE,
+				  k_uptime_get_32() - start);
+
+		if (bank_offset == FLASH_AREA_IMAGE_1_OFFSET) {
+			/* A new image transfer starts from an erased bank */
+			image_verify_start();
+		}
+	}
+
+	return ret;
+}
+
+int boot_write_image_chunk(u32_t offset, const void *data, size_t len)
+{
+	int ret;
+
+	flash_write_protection_set(flash_dev, false);
+	ret = flash_write(flash_dev, FLASH_AREA_IMAGE_1_OFFSET + offset,
+			  data, len);
+	flash_write_protection_set(flash_dev, true);
+
+	if (!ret) {
+		image_verify_update(offset, data, len);
+	}
+
 	return ret;
 }
 
@@ -30,8 +30,45 @@ extern struct device *flash_dev;
 
 boot_status_t boot_status_read(void);
 void boot_status_update(void);
-void boot_trigger_ota(void);
+
+/**
+ * @brief Mark the image in bank 1 for swap on next boot.
+ *
+ * The image hash is verified first. If it was not computed while the
+ * image was written, it is computed by re-reading the bank from the
+ * application work queue, and the swap is only armed once that
+ * succeeds.
+ *
+ * @return 0 if the swap was armed, -EINPROGRESS if verification was
+ *         deferred to the work queue, negative errno on failure.
+ */
+int boot_trigger_ota(void);
 
 int boot_erase_flash_bank(u32_t bank_offset);
 
+/**
+ * @brief Flash bank erase hook.
+ *
+ * Called after each successful boot_erase_flash_bank(). The default
+ * implementation does nothing; applications may override it to watch
+ * flash timing.
+ *
+ * @param len        Number of bytes erased.
+ * @param elapsed_ms Time the erase took, in ms.
+ */
+void boot_flash_erased(u32_t len, u32_t elapsed_ms);
+
+/**
+ * @brief Write a chunk of the update image to bank 1.
+ *
+ * Chunks written in order are hashed on the fly, so the image can be
+ * verified as soon as the last one lands.
+ *
+ * @param offset Offset of the chunk relative to the start of bank 1.
+ * @param data   Chunk data.
+ * @param len    Chunk length in bytes.
+ * @return flash_write() return value.
+ */
+int boot_write_image_chunk(u32_t offset, const void *data, size_t len);
+
 #endif	/* __FOTA_MCUBOOT_H__ */
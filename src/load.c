@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define SYS_LOG_DOMAIN "fota/load"
+#define SYS_LOG_LEVEL CONFIG_SYS_LOG_FOTA_LEVEL
+#include <logging/sys_log.h>
+
+#include <zephyr.h>
+
+#include "timer_wheel.h"
+#include "telemetry.h"
+#include "load.h"
+
+#define LOAD_PERIOD	CONFIG_APP_LOAD_PERIOD
+
+/*
+ * Thresholds, on averaged received messages per second and duplicate
+ * percentage. Leaving a level takes falling below half its entry
+ * threshold, so the level does not flap around a boundary.
+ */
+#define HIGH_RATE	20
+#define HIGH_DUP	30
+#define LOW_RATE	2
+#define LOW_DUP		10
+
+/* Averages are kept in 1/16 units, with a 1/4 smoothing factor */
+#define AVG_SHIFT	4
+#define AVG_WEIGHT	2
+
+/* Network transmit bounds */
+#define TRANSMIT_COUNT_MIN	1
+#define TRANSMIT_INT_MAX	100
+
+/*
+ * Reply delays. The spec suggests 20 to 50 ms for unicast messages,
+ * which only the destination answers, whatever the load. For group
+ * addressed messages, up to 500 ms: the delay is drawn from
+ * [window / 2, 3 * window / 2) with a window per level, plus
+ * window / 2 per hop to the sender.
+ */
+#define UNICAST_DELAY_MIN	20
+#define UNICAST_DELAY_MAX	50
+
+static const u16_t reply_window[] = {
+	[LOAD_LOW] = 20,
+	[LOAD_MEDIUM] = 50,
+	[LOAD_HIGH] = 150,
+};
+
+#define MAX_HOPS	3
+
+#define ADDR_IS_UNICAST(addr)	((addr) && (addr) < 0x8000)
+
+static struct bt_mesh_cfg *cfg;
+static struct wheel_timer load_timer;
+static enum load_level level = LOAD_MEDIUM;
+
+static u32_t rate_avg;
+static u32_t dup_avg;
+static u32_t last_rx;
+static u32_t last_dup;
+
+/*
+ * Network transmit state as set by the Configuration Client (the
+ * medium load setting), and as last written to the Configuration
+ * Server state for the stack to use.
+ */
+static u8_t transmit_conf;
+static u8_t transmit_applied;
+
+static u8_t transmit_for(enum load_level new_level)
+{
+	u8_t count = BT_MESH_TRANSMIT_COUNT(transmit_conf);
+	u16_t interval = BT_MESH_TRANSMIT_INT(transmit_conf);
+
+	switch (new_level) {
+	case LOAD_LOW:
+		/* Quiet channel: one retransmission less, if any */
+		if (count > TRANSMIT_COUNT_MIN) {
+			count--;
+		}
+		break;
+	case LOAD_HIGH:
+		/* Busy channel: spread retransmissions out, never closer */
+		if (interval < TRANSMIT_INT_MAX) {
+			interval = min(interval * 2, TRANSMIT_INT_MAX);
+		}
+		break;
+	default:
+		break;
+	}
+
+	return BT_MESH_TRANSMIT(count, interval);
+}
+
+static enum load_level level_next(u32_t rate, u32_t dup)
+{
+	switch (level) {
+	case LOAD_HIGH:
+		if (rate < HIGH_RATE / 2 && dup < HIGH_DUP / 2) {
+			return LOAD_MEDIUM;
+		}
+		break;
+	case LOAD_LOW:
+		if (rate >= LOW_RATE * 2 || dup >= LOW_DUP * 2) {
+			return LOAD_MEDIUM;
+		}
+		break;
+	default:
+		if (rate >= HIGH_RATE || dup >= HIGH_DUP) {
+			return LOAD_HIGH;
+		}
+		if (rate < LOW_RATE && dup < LOW_DUP) {
+			return LOAD_LOW;
+		}
+		break;
+	}
+
+	return level;
+}
+
+static void load_handler(struct wheel_timer *timer)
+{
+	u32_t rx = telemetry_get(TELEMETRY_RX);
+	u32_t dup = telemetry_get(TELEMETRY_DUP);
+	u32_t rx_delta = rx - last_rx;
+	u32_t dup_delta = dup - last_dup;
+	u32_t rate, ratio;
+	enum load_level new_level;
+	bool conf_changed;
+	int key;
+
+	last_rx = rx;
+	last_dup = dup;
+
+	rate = (rx_delta * MSEC_PER_SEC << AVG_SHIFT) / LOAD_PERIOD;
+	ratio = rx_delta ? (dup_delta * 100 << AVG_SHIFT) / rx_delta : 0;
+
+	rate_avg += ((s32_t)rate - (s32_t)rate_avg) >> AVG_WEIGHT;
+	dup_avg += ((s32_t)ratio - (s32_t)dup_avg) >> AVG_WEIGHT;
+
+	new_level = level_next(rate_avg >> AVG_SHIFT, dup_avg >> AVG_SHIFT);
+
+	/*
+	 * The Configuration Server updates the state without telling us:
+	 * a value other than the one applied is a new configured value.
+	 * One equal to it can't be told apart, see load.h. The state is
+	 * set from the Bluetooth RX thread: interrupts are locked so a
+	 * Set can't land between the check and the write.
+	 */
+	key = irq_lock();
+
+	conf_changed = cfg->net_transmit != transmit_applied;
+	if (conf_changed) {
+		transmit_conf = cfg->net_transmit;
+	}
+	if (conf_changed || new_level != level) {
+		transmit_applied = transmit_for(new_level);
+		cfg->net_transmit = transmit_applied;
+	}
+
+	irq_unlock(key);
+
+	if (conf_changed) {
+		SYS_LOG_DBG("Network transmit set to 0x%02x", transmit_conf);
+	}
+
+	if (new_level != level) {
+		level = new_level;
+
+		SYS_LOG_INF("Load %d (%u msg/s, %u%% dup): %d tx, %d ms",
+			    level, rate_avg >> AVG_SHIFT, dup_avg >> AVG_SHIFT,
+			    BT_MESH_TRANSMIT_COUNT(transmit_applied) + 1,
+			    BT_MESH_TRANSMIT_INT(transmit_applied));
+	}
+
+	wheel_timer_arm(&load_timer, LOAD_PERIOD, LOAD_PERIOD / 8);
+}
+
+enum load_level load_level_get(void)
+{
+	return level;
+}
+
+u32_t load_reply_delay(struct bt_mesh_msg_ctx *ctx)
+{
+	u32_t window = reply_window[level];
+	int hops;
+
+	if (ADDR_IS_UNICAST(ctx->recv_dst)) {
+		return UNICAST_DELAY_MIN + sys_rand32_get() %
+		       (UNICAST_DELAY_MAX - UNICAST_DELAY_MIN + 1);
+	}
+
+	/*
+	 * Every node of the group answers: let the nearest go first.
+	 * The hop count assumes the sender used the same default TTL
+	 * as us.
+	 */
+	hops = cfg->default_ttl - ctx->recv_ttl;
+	hops = max(0, min(hops, MAX_HOPS));
+
+	return window / 2 + sys_rand32_get() % window + hops * window / 2;
+}
+
+void load_init(struct bt_mesh_cfg *cfg_srv)
+{
+	cfg = cfg_srv;
+	transmit_conf = cfg->net_transmit;
+	transmit_applied = cfg->net_transmit;
+
+	wheel_timer_init(&load_timer, load_handler);
+#if defined(CONFIG_APP_LOAD_ADAPT)
+	wheel_timer_arm(&load_timer, LOAD_PERIOD, LOAD_PERIOD / 8);
+#endif
+}
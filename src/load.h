@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __FOTA_LOAD_H__
+#define __FOTA_LOAD_H__
+
+/**
+ * @file
+ * @brief Channel load estimator
+ *
+ * Estimates how busy the mesh is around the node from the rate of
+ * access messages received and the share of them which are
+ * transaction duplicates, and adapts to it:
+ *
+ * - the network transmit count and interval: fewer retransmissions
+ *   when the channel is quiet, more widely spaced ones when it is
+ *   busy;
+ * - the random backoff before replying to a group addressed message,
+ *   which widens with load, and is offset by the hop distance to the
+ *   sender so that nearer responders answer first. Replies to
+ *   unicast messages always wait 20 to 50 ms.
+ *
+ * The network transmit state set through the Configuration Server is
+ * the medium load setting; the low and high load ones are derived
+ * from it, within fixed bounds: a count is only lowered if above 1,
+ * an interval only widened, up to 100 ms.
+ *
+ * The mesh stack transmits with the Configuration Server state, so
+ * the adapted value overrides it while the load is low or high, and
+ * a Config Network Transmit Get then reports the adapted value; the
+ * configured one is kept aside to derive from. A Config Network
+ * Transmit Set is noticed as a change of the state, at the next
+ * estimator period. The Configuration Server gives no notification
+ * of it, so a Set to exactly the value currently applied is taken as
+ * no change, and the previous configured value stays the base.
+ */
+
+#include <zephyr/types.h>
+#include <bluetooth/mesh.h>
+
+enum load_level {
+	LOAD_LOW,
+	LOAD_MEDIUM,
+	LOAD_HIGH,
+};
+
+/**
+ * @brief Start the estimator.
+ *
+ * Must be called after timer_wheel_init(). Without
+ * CONFIG_APP_LOAD_ADAPT, the load stays at LOAD_MEDIUM.
+ *
+ * @param cfg Configuration Server state, whose net_transmit is
+ *            adapted.
+ */
+void load_init(struct bt_mesh_cfg *cfg);
+
+/**
+ * @brief Get the current load level.
+ * @return Load level, see enum load_level.
+ */
+enum load_level load_level_get(void);
+
+/**
+ * @brief Pick the delay before replying to a message.
+ * @param ctx Context of the message being replied to.
+ * @return Delay in milliseconds.
+ */
+u32_t load_reply_delay(struct bt_mesh_msg_ctx *ctx);
+
+#endif	/* __FOTA_LOAD_H__ */
@@ -20,34 +20,36 @@
 /* Local helpers and functions */
 #include "tstamp_log.h"
 #include "app_work_queue.h"
+#include "timer_wheel.h"
+#include "effect.h"
+#include "reply.h"
 #include "mcuboot.h"
+#include "image_verify.h"
 #include "product_id.h"
-
-#define REPLY_EXP_RANGE 50
-
-/* Force CID from Nordic as our main use cases are nRF5-based devices */
-#define CID_NORDIC 0x0059
+#include "scene.h"
+#include "telemetry.h"
+#include "health.h"
+#include "trace.h"
+#include "load.h"
+#include "mesh_models.h"
 
 struct device *flash_dev;
 
-/* Blink */
-struct pwm_blink_ctx {
-	struct k_delayed_work work;
-	u32_t delay;
-	u32_t count;
-};
+#if defined(CONFIG_FOTA_IMAGE_VERIFY)
+/* Re-read image verification runs on the application work queue */
+void image_verify_submit(struct k_work *work)
+{
+	app_wq_submit(work);
+}
+#endif
 
-struct gpio_blink_ctx {
-	struct k_delayed_work work;
+/* Status LED, used for provisioning feedback */
+struct gpio_led {
 	struct device *gpio;
 	u32_t gpio_pin;
-	u32_t count;
 };
 
-static struct pwm_blink_ctx pwm_blink_context;
-static struct gpio_blink_ctx prov_blink_context;
-
-#define PROV_BLINK_DELAY	K_SECONDS(1)
+static struct gpio_led status_led;
 
 /* PWM */
 
@@ -56,6 +58,10 @@ static struct gpio_blink_ctx prov_blink_context;
 
 static struct device *pwm_white;
 static u8_t white_current;
+static u8_t white_dimmer;	/* last level applied, 0 to 100 */
+
+/* Dimmer level (0-100) used while the light is on */
+static u8_t light_level;
 
 static u32_t scale_pulse(u8_t level, u8_t ceiling)
 {
@@ -92,6 +98,7 @@ static int update_pwm(u8_t dimmer)
 		dimmer = 100;
 	}
 
+	white_dimmer = dimmer;
 	white = 255 * dimmer / 100;
 	if (white != white_current) {
 		white_current = white;
@@ -106,6 +113,82 @@ static int update_pwm(u8_t dimmer)
 	return ret;
 }
 
+/* Effect engine backend */
+static int light_channel_set(u8_t channel, u8_t level)
+{
+	switch (channel) {
+	case EFFECT_CH_WHITE:
+		return update_pwm(level);
+	case EFFECT_CH_STATUS:
+		if (!status_led.gpio) {
+			return -ENODEV;
+		}
+		return gpio_pin_write(status_led.gpio, status_led.gpio_pin,
+				      level ? 1 : 0);
+	}
+
+	return -EINVAL;
+}
+
+static const struct effect_backend light_backend = {
+	.set = light_channel_set,
+};
+
+/* Health Server hooks */
+static void light_attention(bool on)
+{
+	if (on) {
+		effect_play(EFFECT_CH_WHITE, EFFECT_IDENTIFY, 100, 1);
+	} else {
+		effect_set(EFFECT_CH_WHITE, light_level);
+	}
+}
+
+/*
+ * Time the effect backend, from a level to the PWM driver: move the
+ * white channel one step away from its current level and back. The
+ * effect engine is bypassed, so a running effect keeps playing; it
+ * emits nothing meanwhile, as it only runs with the scheduler locked.
+ */
+static int light_self_test(u32_t *latency_us)
+{
+	u32_t start, cycles, worst = 0;
+	u8_t level, probe;
+	int i, ret = 0;
+
+	if (!pwm_white) {
+		return -ENODEV;
+	}
+
+	k_sched_lock();
+
+	level = white_dimmer;
+	probe = level < 100 ? level + 1 : level - 1;
+
+	for (i = 0; i < 2 && !ret; i++) {
+		start = k_cycle_get_32();
+		ret = light_backend.set(EFFECT_CH_WHITE, i ? level : probe);
+		cycles = k_cycle_get_32() - start;
+		worst = max(worst, cycles);
+	}
+
+	/* Leave the channel as the effect engine last set it */
+	if (ret) {
+		light_backend.set(EFFECT_CH_WHITE, level);
+	}
+
+	k_sched_unlock();
+
+	*latency_us = SYS_CLOCK_HW_CYCLES_TO_NS(worst) / NSEC_PER_USEC;
+
+	return ret;
+}
+
+static const struct health_ops light_health_ops = {
+	.attention = light_attention,
+	.self_test = light_self_test,
+};
+
 static int init_pwm(void)
 {
 	pwm_white = device_get_binding(CONFIG_APP_PWM_WHITE_DEV);
@@ -126,7 +209,11 @@ static struct bt_mesh_cfg cfg_srv = {
 	.relay = BT_MESH_RELAY_NOT_SUPPORTED,
 #endif
 	.beacon = BT_MESH_BEACON_ENABLED,
+#if defined(CONFIG_BT_MESH_FRIEND)
+	.frnd = BT_MESH_FRIEND_ENABLED,
+#else
 	.frnd = BT_MESH_FRIEND_NOT_SUPPORTED,
+#endif
 #if defined(CONFIG_BT_MESH_GATT_PROXY)
 	.gatt_proxy = BT_MESH_GATT_PROXY_ENABLED,
 #else
@@ -139,48 +226,258 @@ static struct bt_mesh_cfg cfg_srv = {
 	 */
 	.default_ttl = 5,
 
-	/* 3 transmissions with 20ms interval */
+	/* 3 transmissions with 20ms interval, adapted to load (load.c) */
 	.net_transmit = BT_MESH_TRANSMIT(2, 20),
 	.relay_retransmit = BT_MESH_TRANSMIT(2, 20),
 };
 
-static struct bt_mesh_health health_srv = {
-};
+static int gen_onoff_pub_update(struct bt_mesh_model *model);
 
-static struct bt_mesh_model_pub gen_onoff_pub;
+/* Model opcode handlers, defined below */
+APP_ROOT_MODELS(MODEL_HANDLERS_DECL)
+APP_VND_MODELS(MODEL_HANDLERS_DECL)
+
+/* Publication message is preallocated: 2 for opcode, 1 for OnOff */
+static struct bt_mesh_model_pub gen_onoff_pub = {
+	.msg = NET_BUF_SIMPLE(2 + 1),
+	.update = gen_onoff_pub_update,
+};
+static struct bt_mesh_model_pub scene_pub;
 
 static u8_t onoff_state;
 
-static void gen_onoff_reply_status(struct bt_mesh_model *model,
-				   struct bt_mesh_msg_ctx *src_ctx)
+/* Scene last recalled, until the light state changes otherwise */
+static u16_t scene_current;
+
+/*
+ * Transaction cache: messages with the same source, destination and
+ * TID received within TID_TIMEOUT belong to the same transaction (e.g.
+ * retransmissions by the sender) and must only be applied once.
+ */
+#define TID_CACHE_SIZE	4
+#define TID_TIMEOUT	K_SECONDS(6)
+
+struct tid_entry {
+	u16_t src;
+	u16_t dst;
+	u8_t tid;
+	s64_t timestamp;
+};
+
+static struct tid_entry tid_cache[TID_CACHE_SIZE];
+static u8_t tid_cache_next;
+
+static bool transaction_is_dup(struct bt_mesh_msg_ctx *ctx, u8_t tid)
+{
+	s64_t now = k_uptime_get();
+	struct tid_entry *entry;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(tid_cache); i++) {
+		entry = &tid_cache[i];
+		if (entry->src == ctx->addr && entry->dst == ctx->recv_dst &&
+		    entry->tid == tid &&
+		    now - entry->timestamp < TID_TIMEOUT) {
+			telemetry_count(TELEMETRY_DUP);
+			return true;
+		}
+	}
+
+	/* New transaction, replace the oldest entry */
+	entry = &tid_cache[tid_cache_next];
+	tid_cache_next = (tid_cache_next + 1) % ARRAY_SIZE(tid_cache);
+
+	if (entry->timestamp && now - entry->timestamp < TID_TIMEOUT) {
+		/* Cache too small for the traffic */
+		telemetry_count(TELEMETRY_TID_EVICTED);
+	}
+
+	entry->src = ctx->addr;
+	entry->dst = ctx->recv_dst;
+	entry->tid = tid;
+	entry->timestamp = now;
+
+	return false;
+}
+
+/*
+ * Change-driven publication
+ *
+ * State changes are not published right away: the first change arms a
+ * hold-off timer, and whatever the state is when it expires gets
+ * published, so a burst of changes results in a single Status.
+ *
+ * All publications (change-driven and periodic) draw from a token
+ * bucket, refilled with one token every CONFIG_APP_PUB_TOKEN_MS and
+ * holding at most CONFIG_APP_PUB_BURST tokens, which caps the status
+ * airtime of a node.
+ *
+ * Publications which never go out count as TELEMETRY_PUB_SUPPRESSED:
+ * changes merged into a pending publication, and periodic publications
+ * skipped for lack of a token. A change-driven publication waiting for
+ * a token is only delayed, and not counted.
+ *
+ * pub_pending is set from model handlers and cleared from the timer.
+ */
+static struct wheel_timer pub_timer;
+static atomic_t pub_pending;
+static u32_t pub_credit_ms = CONFIG_APP_PUB_BURST * CONFIG_APP_PUB_TOKEN_MS;
+static u32_t pub_credit_time;
+
+/*
+ * Take a token from the bucket. Returns 0 on success, or the time in
+ * milliseconds until the next token is available.
+ */
+static u32_t pub_take_token(void)
+{
+	u32_t max = CONFIG_APP_PUB_BURST * CONFIG_APP_PUB_TOKEN_MS;
+	u32_t now, wait = 0;
+	int key;
+
+	key = irq_lock();
+
+	now = k_uptime_get_32();
+	pub_credit_ms = min(pub_credit_ms + (now - pub_credit_time), max);
+	pub_credit_time = now;
+
+	if (pub_credit_ms >= CONFIG_APP_PUB_TOKEN_MS) {
+		pub_credit_ms -= CONFIG_APP_PUB_TOKEN_MS;
+	} else {
+		wait = CONFIG_APP_PUB_TOKEN_MS - pub_credit_ms;
+	}
+
+	irq_unlock(key);
+
+	return wait;
+}
+
+static void gen_onoff_pub_fill(struct net_buf_simple *msg)
+{
+	bt_mesh_model_msg_init(msg, BT_MESH_MODEL_OP_2(0x82, 0x04));
+	net_buf_simple_add_u8(msg, onoff_state);
+}
+
+/* Periodic publication, driven by the mesh stack */
+static int gen_onoff_pub_update(struct bt_mesh_model *model)
+{
+	if (pub_take_token()) {
+		telemetry_count(TELEMETRY_PUB_SUPPRESSED);
+		SYS_LOG_DBG("Periodic publication suppressed (%u so far)",
+			    telemetry_get(TELEMETRY_PUB_SUPPRESSED));
+		return -EBUSY;
+	}
+
+	gen_onoff_pub_fill(model->pub->msg);
+	telemetry_count(TELEMETRY_TX);
+
+	return 0;
+}
+
+static void pub_handler(struct wheel_timer *timer)
+{
+	u32_t wait;
+	int err;
+
+	wait = pub_take_token();
+	if (wait) {
+		/* Out of tokens: publish the final value once refilled */
+		wheel_timer_arm(&pub_timer, wait, 0);
+		return;
+	}
+
+	/* Changes from here on need a new publication */
+	atomic_clear(&pub_pending);
+
+	gen_onoff_pub_fill(gen_onoff_pub.msg);
+	err = bt_mesh_model_publish(gen_onoff_pub.mod);
+	if (err) {
+		/* -EADDRNOTAVAIL simply means publication is not set up */
+		if (err != -EADDRNOTAVAIL) {
+			SYS_LOG_ERR("Unable to publish OnOff Status (err %d)",
+				    err);
+		}
+		if (err == -ENOBUFS) {
+			telemetry_count(TELEMETRY_ADV_STARVED);
+			health_fault_raise(HEALTH_FAULT_ADV_STARVED);
+		}
+		return;
+	}
+
+	telemetry_count(TELEMETRY_TX);
+	SYS_LOG_DBG("Published OnOff Status (state: %d, %u suppressed)",
+		    onoff_state, telemetry_get(TELEMETRY_PUB_SUPPRESSED));
+}
+
+static void pub_on_change(void)
+{
+	if (atomic_set(&pub_pending, 1)) {
+		/* Merged into the pending publication */
+		telemetry_count(TELEMETRY_PUB_SUPPRESSED);
+		return;
+	}
+
+	wheel_timer_arm(&pub_timer, CONFIG_APP_PUB_HOLDOFF,
+			CONFIG_APP_PUB_HOLDOFF / 2);
+}
+
+/*
+ * Apply a new light level (0 is off). When turning on with a non-zero
+ * delay, the light blinks with a period of 400 ms per delay unit.
+ */
+static void light_set(u8_t level, int delay)
+{
+	onoff_state = level ? 1 : 0;
+	light_level = level;
+	scene_current = SCENE_NONE;
+
+	SYS_LOG_DBG("Set Blink delay to %d", delay);
+	if (level && delay) {
+		effect_play(EFFECT_CH_WHITE, EFFECT_BLINK, level, delay);
+	} else {
+		effect_set(EFFECT_CH_WHITE, level);
+	}
+
+	pub_on_change();
+}
+
+static void model_reply_delayed(struct bt_mesh_model *model,
+				struct bt_mesh_msg_ctx *src_ctx,
+				struct net_buf_simple *msg, u32_t delay_ms)
 {
-	/* 2 for msg_init, 4 for OnOff Status and 4 for TransMIC */
-	struct net_buf_simple *msg = NET_BUF_SIMPLE(2 + 4 + 4);
 	struct bt_mesh_msg_ctx ctx;
-	int exp_ms;
 
 	/* Reuse source ctx (addr is already the right remote) */
 	memcpy(&ctx, src_ctx, sizeof(ctx));
 	ctx.send_ttl = cfg_srv.default_ttl;
 
+	if (reply_send(model, &ctx, msg, delay_ms)) {
+		SYS_LOG_ERR("Unable to schedule reply message");
+	}
+}
+
+static void model_reply(struct bt_mesh_model *model,
+			struct bt_mesh_msg_ctx *ctx,
+			struct net_buf_simple *msg)
+{
+	/*
+	 * Add delay to avoid overloading network, depending on the
+	 * channel load and on the distance to the sender.
+	 */
+	model_reply_delayed(model, ctx, msg, load_reply_delay(ctx));
+}
+
+static void gen_onoff_reply_status(struct bt_mesh_model *model,
+				   struct bt_mesh_msg_ctx *ctx)
+{
+	/* 2 for msg_init, 4 for OnOff Status and 4 for TransMIC */
+	struct net_buf_simple *msg = NET_BUF_SIMPLE(2 + 4 + 4);
+
 	/* Generic OnOff Status */
 	bt_mesh_model_msg_init(msg, BT_MESH_MODEL_OP_2(0x82, 0x04));
 	net_buf_simple_add_u8(msg, onoff_state);
 	SYS_LOG_DBG("Sending OnOff Status (state: %d)", onoff_state);
 
-	/*
-	 * HACK: add delay to avoid overloading network. Suggestion
-	 * from spec is to use something between 20 to 50 ms / 200 ms.
-	 * TODO: change to be handled by a worker instead
-	 */
-	exp_ms = (REPLY_EXP_RANGE / 2) + sys_rand32_get() % REPLY_EXP_RANGE;
-	k_sleep(exp_ms);
-
-	SYS_LOG_DBG("Remote Address: %x, Send TTL: %d",
-				ctx.addr, ctx.send_ttl);
-	if (bt_mesh_model_send(model, &ctx, msg, NULL, NULL)) {
-		SYS_LOG_ERR("Unable to send Generic OnOff Status message");
-	}
+	model_reply(model, ctx, msg);
 }
 
 static void gen_onoff_get(struct bt_mesh_model *model,
@@ -206,10 +503,9 @@ static int onoff_set(struct bt_mesh_model *model,
 	SYS_LOG_DBG("onoff: %d, tid: %d", onoff, tid);
 
 	if (onoff != onoff_state) {
-		onoff_state = onoff;
-		SYS_LOG_DBG("Internal light state changed to %d", onoff_state);
+		SYS_LOG_DBG("Internal light state changed to %d", onoff);
 
-		if (onoff_state) {
+		if (onoff) {
 			/* Use TTL to define the blink delay */
 			/* TODO: Fetch TTL from the sender */
 			delay = cfg_srv.default_ttl - ctx->recv_ttl;
@@ -218,15 +514,7 @@ static int onoff_set(struct bt_mesh_model *model,
 			}
 		}
 
-		/* Remove possible pending previous work */
-		k_delayed_work_cancel(&pwm_blink_context.work);
-
-		SYS_LOG_DBG("Set Blink delay to %d seconds", delay);
-		pwm_blink_context.count = 1;
-		pwm_blink_context.delay = 50 * (delay * 4);
-
-		/* TODO: Use model delay instead of 10 ms */
-		k_delayed_work_submit(&pwm_blink_context.work, 10);
+		light_set(onoff ? 100 : 0, delay);
 
 		return 1;
 	}
@@ -251,21 +539,348 @@ static void gen_onoff_set_unack(struct bt_mesh_model *model,
 	onoff_set(model, ctx, buf);
 }
 
-static const struct bt_mesh_model_op gen_onoff_op[] = {
-	{ BT_MESH_MODEL_OP_2(0x82, 0x01), 0, gen_onoff_get },
-	{ BT_MESH_MODEL_OP_2(0x82, 0x02), 2, gen_onoff_set },
-	{ BT_MESH_MODEL_OP_2(0x82, 0x03), 2, gen_onoff_set_unack },
-	BT_MESH_MODEL_OP_END,
-};
+/*
+ * Bulk State vendor model
+ *
+ * Sets the level of many fixtures with a single (segmented) message
+ * instead of one Generic OnOff Set per fixture. Fixtures are addressed
+ * by the offset of their primary unicast address from a base address
+ * carried in the message. Both messages are unacknowledged, as they
+ * are meant to be sent to group addresses.
+ *
+ * Bulk Levels:  TID (1), base (2), N x { offset (1), level (1) }
+ *               with entries sorted by offset.
+ * Bulk Bitmap:  TID (1), base (2), level (1), bitmap (N)
+ *               where bit i (LSB first) selects fixture base + i.
+ *
+ * Airtime: with 3 transmissions per PDU, a 200 fixture scene needs 600
+ * advertising packets as individual Sets, versus 3 x 36 segments for
+ * two Bulk Levels messages (185 entries fit in the 380 byte maximum
+ * access payload, in 32 segments; the other 15 take 4), or 3 x 3
+ * segments for one Bulk Bitmap.
+ */
+#define BULK_ENTRY_LEN		2
+
+static int bulk_offset(struct bt_mesh_model *model,
+		       struct bt_mesh_msg_ctx *ctx,
+		       struct net_buf_simple *buf, u8_t *tid)
+{
+	u16_t base;
+	u16_t addr;
+
+	*tid = net_buf_simple_pull_u8(buf);
+	base = net_buf_simple_pull_le16(buf);
+
+	if (transaction_is_dup(ctx, *tid)) {
+		return -EALREADY;
+	}
+
+	addr = bt_mesh_model_elem(model)->addr;
+	if (addr < base) {
+		return -ENOENT;
+	}
+
+	return addr - base;
+}
+
+static void bulk_levels(struct bt_mesh_model *model,
+			struct bt_mesh_msg_ctx *ctx,
+			struct net_buf_simple *buf)
+{
+	int lo, hi, mid;
+	int offset;
+	u8_t *entry;
+	u8_t tid;
+
+	offset = bulk_offset(model, ctx, buf, &tid);
+	if (offset < 0) {
+		return;
+	}
+
+	/* Binary search for our entry in the sorted payload */
+	lo = 0;
+	hi = buf->len / BULK_ENTRY_LEN - 1;
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		entry = buf->data + mid * BULK_ENTRY_LEN;
+
+		if (entry[0] < offset) {
+			lo = mid + 1;
+		} else if (entry[0] > offset) {
+			hi = mid - 1;
+		} else {
+			SYS_LOG_DBG("Bulk level %d (tid %d)", entry[1], tid);
+			light_set(min(entry[1], 100), 0);
+			return;
+		}
+	}
+}
+
+static void bulk_bitmap(struct bt_mesh_model *model,
+			struct bt_mesh_msg_ctx *ctx,
+			struct net_buf_simple *buf)
+{
+	int offset;
+	u8_t level;
+	u8_t tid;
+
+	offset = bulk_offset(model, ctx, buf, &tid);
+	if (offset < 0) {
+		return;
+	}
+
+	level = net_buf_simple_pull_u8(buf);
+	if (offset / 8 >= buf->len ||
+	    !(buf->data[offset / 8] & BIT(offset % 8))) {
+		return;
+	}
+
+	SYS_LOG_DBG("Bulk level %d (tid %d)", level, tid);
+	light_set(min(level, 100), 0);
+}
+
+/* Scene Server and Scene Setup Server */
+
+#define SCENE_STATUS_SUCCESS		0x00
+#define SCENE_STATUS_REG_FULL		0x01
+#define SCENE_STATUS_NOT_FOUND		0x02
+
+static void scene_reply_status(struct bt_mesh_model *model,
+			       struct bt_mesh_msg_ctx *ctx, u8_t status)
+{
+	/* 1 for msg_init, 3 for Scene Status and 4 for TransMIC */
+	struct net_buf_simple *msg = NET_BUF_SIMPLE(1 + 3 + 4);
+
+	bt_mesh_model_msg_init(msg, BT_MESH_MODEL_OP_1(0x5e));
+	net_buf_simple_add_u8(msg, status);
+	net_buf_simple_add_le16(msg, scene_current);
+	SYS_LOG_DBG("Sending Scene Status (status: %d, scene: %d)",
+		    status, scene_current);
+
+	model_reply(model, ctx, msg);
+}
+
+static void scene_reply_register(struct bt_mesh_model *model,
+				 struct bt_mesh_msg_ctx *ctx, u8_t status)
+{
+	/* 2 for msg_init, 3 + 2 per scene for Register and 4 for TransMIC */
+	struct net_buf_simple *msg = NET_BUF_SIMPLE(REPLY_SCENE_REG_SIZE);
+	u16_t scenes[CONFIG_APP_SCENE_COUNT];
+	int count, i;
+
+	bt_mesh_model_msg_init(msg, BT_MESH_MODEL_OP_2(0x82, 0x45));
+	net_buf_simple_add_u8(msg, status);
+	net_buf_simple_add_le16(msg, scene_current);
+
+	count = scene_list(scenes, ARRAY_SIZE(scenes));
+	for (i = 0; i < count; i++) {
+		net_buf_simple_add_le16(msg, scenes[i]);
+	}
+
+	model_reply(model, ctx, msg);
+}
+
+/*
+ * Returns a Scene Status code, or a negative errno for messages which
+ * must be ignored.
+ */
+static int scene_recall(struct bt_mesh_model *model,
+			struct bt_mesh_msg_ctx *ctx,
+			struct net_buf_simple *buf)
+{
+	u8_t levels[SCENE_CHANNELS];
+	u16_t number;
+	u8_t tid;
+
+	number = net_buf_simple_pull_le16(buf);
+	tid = net_buf_simple_pull_u8(buf);
+
+	/*
+	 * Transition Time and Delay are optional, but come together.
+	 * Transitions are not supported: the scene applies at once.
+	 */
+	if (buf->len == 2) {
+		net_buf_simple_pull(buf, 2);
+	} else if (buf->len) {
+		return -EINVAL;
+	}
+
+	if (number == SCENE_NONE) {
+		return -EINVAL;
+	}
+
+	SYS_LOG_DBG("scene: %d, tid: %d", number, tid);
+
+	if (scene_get(number, levels)) {
+		return SCENE_STATUS_NOT_FOUND;
+	}
+
+	if (!transaction_is_dup(ctx, tid)) {
+		/* Resolved locally, straight into the PWM path */
+		light_set(levels[0], 0);
+		scene_current = number;
+	}
+
+	return SCENE_STATUS_SUCCESS;
+}
+
+static void scene_get_handler(struct bt_mesh_model *model,
+			      struct bt_mesh_msg_ctx *ctx,
+			      struct net_buf_simple *buf)
+{
+	scene_reply_status(model, ctx, SCENE_STATUS_SUCCESS);
+}
+
+static void scene_recall_handler(struct bt_mesh_model *model,
+				 struct bt_mesh_msg_ctx *ctx,
+				 struct net_buf_simple *buf)
+{
+	int status = scene_recall(model, ctx, buf);
+
+	if (status >= 0) {
+		scene_reply_status(model, ctx, status);
+	}
+}
+
+static void scene_recall_unack(struct bt_mesh_model *model,
+			       struct bt_mesh_msg_ctx *ctx,
+			       struct net_buf_simple *buf)
+{
+	scene_recall(model, ctx, buf);
+}
+
+static void scene_register_get(struct bt_mesh_model *model,
+			       struct bt_mesh_msg_ctx *ctx,
+			       struct net_buf_simple *buf)
+{
+	scene_reply_register(model, ctx, SCENE_STATUS_SUCCESS);
+}
+
+/* Like scene_recall(), negative for messages which must be ignored */
+static int scene_store_level(struct net_buf_simple *buf)
+{
+	u8_t levels[SCENE_CHANNELS];
+	u16_t number;
+	int ret;
+
+	number = net_buf_simple_pull_le16(buf);
+	if (number == SCENE_NONE) {
+		return -EINVAL;
+	}
+
+	levels[0] = onoff_state ? light_level : 0;
+
+	ret = scene_store(number, levels);
+	if (ret == -ENOMEM) {
+		return SCENE_STATUS_REG_FULL;
+	} else if (ret) {
+		return SCENE_STATUS_NOT_FOUND;
+	}
+
+	scene_current = number;
+
+	return SCENE_STATUS_SUCCESS;
+}
+
+static void scene_store_handler(struct bt_mesh_model *model,
+				struct bt_mesh_msg_ctx *ctx,
+				struct net_buf_simple *buf)
+{
+	int status = scene_store_level(buf);
+
+	if (status >= 0) {
+		scene_reply_register(model, ctx, status);
+	}
+}
+
+static void scene_store_unack(struct bt_mesh_model *model,
+			      struct bt_mesh_msg_ctx *ctx,
+			      struct net_buf_simple *buf)
+{
+	scene_store_level(buf);
+}
+
+static int scene_delete_number(struct net_buf_simple *buf)
+{
+	u16_t number = net_buf_simple_pull_le16(buf);
+
+	if (number == SCENE_NONE) {
+		return -EINVAL;
+	}
+
+	/* Deleting a scene which is not stored is not an error */
+	scene_delete(number);
+	if (scene_current == number) {
+		scene_current = SCENE_NONE;
+	}
+
+	return 0;
+}
+
+static void scene_delete_handler(struct bt_mesh_model *model,
+				 struct bt_mesh_msg_ctx *ctx,
+				 struct net_buf_simple *buf)
+{
+	if (!scene_delete_number(buf)) {
+		scene_reply_register(model, ctx, SCENE_STATUS_SUCCESS);
+	}
+}
+
+static void scene_delete_unack(struct bt_mesh_model *model,
+			       struct bt_mesh_msg_ctx *ctx,
+			       struct net_buf_simple *buf)
+{
+	scene_delete_number(buf);
+}
+
+/*
+ * Telemetry vendor model
+ *
+ * Telemetry Get: acknowledged sequence (1), reply window (1)
+ * Telemetry Status: snapshot, see telemetry.h
+ *
+ * The Get is meant to be sent to a group address: each node answers
+ * after a random delay within the reply window (in 100 ms units), and
+ * only with what changed since the snapshot the requester last
+ * received, so a gateway can sweep a whole network with one message.
+ */
+#define TELEMETRY_WINDOW_UNIT	100
+
+static void telemetry_get_handler(struct bt_mesh_model *model,
+				  struct bt_mesh_msg_ctx *ctx,
+				  struct net_buf_simple *buf)
+{
+	/* 3 for msg_init, snapshot and 4 for TransMIC */
+	struct net_buf_simple *msg = NET_BUF_SIMPLE(REPLY_TELEMETRY_SIZE);
+	u8_t ack_seq;
+	u32_t window;
+
+	ack_seq = net_buf_simple_pull_u8(buf);
+	window = net_buf_simple_pull_u8(buf) * TELEMETRY_WINDOW_UNIT;
+
+	bt_mesh_model_msg_init(msg, TELEMETRY_OP_STATUS);
+	telemetry_snapshot(msg, ack_seq);
+
+	if (window) {
+		model_reply_delayed(model, ctx, msg,
+				    sys_rand32_get() % window);
+	} else {
+		model_reply(model, ctx, msg);
+	}
+}
+
+/* Opcode tables and composition data, generated from mesh_models.h */
+APP_ROOT_MODELS(MODEL_OP_TABLE)
+APP_VND_MODELS(MODEL_OP_TABLE)
 
 static struct bt_mesh_model root_models[] = {
 	BT_MESH_MODEL_CFG_SRV(&cfg_srv),
 	BT_MESH_MODEL_HEALTH_SRV(&health_srv),
-	BT_MESH_MODEL(BT_MESH_MODEL_ID_GEN_ONOFF_SRV, gen_onoff_op,
-		      &gen_onoff_pub, NULL),
+	APP_ROOT_MODELS(MODEL_SIG_ENTRY)
 };
 
 static struct bt_mesh_model vnd_models[] = {
+	APP_VND_MODELS(MODEL_VND_ENTRY)
 };
 
 static struct bt_mesh_elem elements[] = {
@@ -283,21 +898,19 @@ static void prov_complete(void)
 	SYS_LOG_INF("Provisioning completed!");
 
 #if defined(BT_GPIO_PIN) && defined(BT_GPIO_PORT)
-	prov_blink_context.gpio = device_get_binding(BT_GPIO_PORT);
-	prov_blink_context.gpio_pin = BT_GPIO_PIN;
+	status_led.gpio = device_get_binding(BT_GPIO_PORT);
+	status_led.gpio_pin = BT_GPIO_PIN;
 #elif defined(LED0_GPIO_PIN) && defined(LED0_GPIO_PORT)
 	/* Use LED0 in case there is no dedicated LED for BT */
-	prov_blink_context.gpio = device_get_binding(LED0_GPIO_PORT);
-	prov_blink_context.gpio_pin = LED0_GPIO_PIN;
+	status_led.gpio = device_get_binding(LED0_GPIO_PORT);
+	status_led.gpio_pin = LED0_GPIO_PIN;
 #endif
 
-	if (prov_blink_context.gpio) {
-		gpio_pin_configure(prov_blink_context.gpio,
-				   prov_blink_context.gpio_pin,
+	if (status_led.gpio) {
+		gpio_pin_configure(status_led.gpio, status_led.gpio_pin,
 				   GPIO_DIR_OUT);
 
-		app_wq_submit_delayed(&prov_blink_context.work,
-				      PROV_BLINK_DELAY);
+		effect_play(EFFECT_CH_STATUS, EFFECT_PROVISIONED, 100, 1);
 	}
 }
 
@@ -337,47 +950,29 @@ static void bt_ready(int err)
 	SYS_LOG_INF("Mesh initialized");
 }
 
-static void pwm_blink_handler(struct k_work *work)
-{
-	struct pwm_blink_ctx *blink =
-			CONTAINER_OF(work, struct pwm_blink_ctx, work);
-
-	if (onoff_state) {
-		if (blink->delay) {
-			/* Blink depending on the value */
-			update_pwm(100 * (blink->count++ % 2));
-			k_delayed_work_submit(&blink->work, blink->delay);
-		} else {
-			update_pwm(100);
-		}
-	} else {
-		/* Just turn it off */
-		update_pwm(0);
-		blink->delay = 0;
-	}
-}
-
-static void prov_blink_handler(struct k_work *work)
-{
-	struct gpio_blink_ctx *blink =
-		CONTAINER_OF(work, struct gpio_blink_ctx, work);
-
-	gpio_pin_write(blink->gpio, blink->gpio_pin, blink->count++ % 2);
-	app_wq_submit_delayed(&blink->work, PROV_BLINK_DELAY);
-}
-
 void main(void)
 {
 	int ret;
 
 	tstamp_hook_install();
 	app_wq_init();
+	timer_wheel_init();
+	reply_init();
+
+	/* Blinking patterns and visual feedback for provisioning */
+	effect_init(&light_backend);
+
+	/* Change-driven publication */
+	wheel_timer_init(&pub_timer, pub_handler);
+
+	/* Performance faults, attention and self-test */
+	health_init(&light_health_ops);
 
-	/* Blinking pattern handler */
-	k_delayed_work_init(&pwm_blink_context.work, pwm_blink_handler);
+	/* Access message capture, for tools/replay */
+	trace_init();
 
-	/* Visual feedback for provisioning */
-	k_delayed_work_init(&prov_blink_context.work, prov_blink_handler);
+	/* Network transmit and reply backoff follow the channel load */
+	load_init(&cfg_srv);
 
 	SYS_LOG_INF("Bluetooth Mesh Smart Light Bulb");
 	SYS_LOG_INF("Device: %s, Serial: %x",
@@ -391,6 +986,14 @@ void main(void)
 	}
 	_TC_END_RESULT(TC_PASS, "init_pwm");
 
+	TC_PRINT("Loading scene table\n");
+	if (scene_init()) {
+		/* Not fatal, start with an empty table */
+		_TC_END_RESULT(TC_FAIL, "init_scene");
+	} else {
+		_TC_END_RESULT(TC_PASS, "init_scene");
+	}
+
 	TC_PRINT("Initializing Bluetooth Stack\n");
 	ret = bt_enable(bt_ready);
 	if (ret) {
@@ -403,6 +1006,8 @@ void main(void)
 
 	TC_END_REPORT(TC_PASS);
 
+	app_wq_ram_report();
+
 	/*
 	 * From this point on, just handle work.
 	 */
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __FOTA_MESH_MODELS_H__
+#define __FOTA_MESH_MODELS_H__
+
+/**
+ * @file
+ * @brief Declarative description of the application's mesh models
+ *
+ * The composition data (root_models[] and vnd_models[]) and the
+ * per-model opcode tables are generated from the lists below, so
+ * adding a model only takes a MODEL() entry plus the MODEL_OPS_<name>
+ * list of its opcodes. The Configuration and Health Server models are
+ * not listed: the mesh stack provides their opcode tables.
+ *
+ *   MODEL(id, name, pub)
+ *     id:   SIG or vendor model identifier
+ *     name: prefix of the generated name##_op[] opcode table
+ *     pub:  publication context, or NULL
+ *
+ *   OP(opcode, min_len, handler)
+ *     min_len: shortest valid payload; shorter messages are dropped
+ *     by the mesh stack before reaching the handler.
+ */
+
+/* Force CID from Nordic as our main use cases are nRF5-based devices */
+#define CID_NORDIC 0x0059
+
+/* Vendor models */
+#define VND_MODEL_ID_BULK_SRV		0x0001
+#define VND_MODEL_ID_TELEMETRY_SRV	0x0002
+
+#define BULK_OP_LEVELS		BT_MESH_MODEL_OP_3(0x01, CID_NORDIC)
+#define BULK_OP_BITMAP		BT_MESH_MODEL_OP_3(0x02, CID_NORDIC)
+#define TELEMETRY_OP_GET	BT_MESH_MODEL_OP_3(0x03, CID_NORDIC)
+#define TELEMETRY_OP_STATUS	BT_MESH_MODEL_OP_3(0x04, CID_NORDIC)
+
+/* SIG models of the primary element */
+#define APP_ROOT_MODELS(MODEL)						\
+	MODEL(BT_MESH_MODEL_ID_GEN_ONOFF_SRV, gen_onoff, &gen_onoff_pub)	\
+	MODEL(BT_MESH_MODEL_ID_SCENE_SRV, scene, &scene_pub)		\
+	MODEL(BT_MESH_MODEL_ID_SCENE_SETUP_SRV, scene_setup, NULL)
+
+/* Vendor models of the primary element */
+#define APP_VND_MODELS(MODEL)						\
+	MODEL(VND_MODEL_ID_BULK_SRV, bulk, NULL)			\
+	MODEL(VND_MODEL_ID_TELEMETRY_SRV, telemetry, NULL)
+
+#define MODEL_OPS_gen_onoff(OP)						\
+	OP(BT_MESH_MODEL_OP_2(0x82, 0x03), 2, gen_onoff_set_unack)	\
+	OP(BT_MESH_MODEL_OP_2(0x82, 0x02), 2, gen_onoff_set)		\
+	OP(BT_MESH_MODEL_OP_2(0x82, 0x01), 0, gen_onoff_get)
+
+#define MODEL_OPS_scene(OP)						\
+	OP(BT_MESH_MODEL_OP_2(0x82, 0x43), 3, scene_recall_unack)	\
+	OP(BT_MESH_MODEL_OP_2(0x82, 0x42), 3, scene_recall_handler)	\
+	OP(BT_MESH_MODEL_OP_2(0x82, 0x41), 0, scene_get_handler)	\
+	OP(BT_MESH_MODEL_OP_2(0x82, 0x44), 0, scene_register_get)
+
+#define MODEL_OPS_scene_setup(OP)					\
+	OP(BT_MESH_MODEL_OP_2(0x82, 0x46), 2, scene_store_handler)	\
+	OP(BT_MESH_MODEL_OP_2(0x82, 0x47), 2, scene_store_unack)	\
+	OP(BT_MESH_MODEL_OP_2(0x82, 0x9e), 2, scene_delete_handler)	\
+	OP(BT_MESH_MODEL_OP_2(0x82, 0x9f), 2, scene_delete_unack)
+
+#define MODEL_OPS_bulk(OP)						\
+	OP(BULK_OP_LEVELS, 3, bulk_levels)				\
+	OP(BULK_OP_BITMAP, 4, bulk_bitmap)
+
+#define MODEL_OPS_telemetry(OP)						\
+	OP(TELEMETRY_OP_GET, 2, telemetry_get_handler)
+
+/* Generators, for use in the file defining the handlers */
+
+#define MODEL_OP_HANDLER_DECL(_opcode, _min_len, _handler)		\
+	static void _handler(struct bt_mesh_model *model,		\
+			     struct bt_mesh_msg_ctx *ctx,		\
+			     struct net_buf_simple *buf);
+
+/*
+ * Received messages are accounted for, and captured when tracing,
+ * before reaching the handler
+ */
+#define MODEL_OP_RX_WRAPPER(_opcode, _min_len, _handler)		\
+	static void _handler##_rx(struct bt_mesh_model *model,		\
+				  struct bt_mesh_msg_ctx *ctx,		\
+				  struct net_buf_simple *buf)		\
+	{								\
+		telemetry_rx();						\
+		trace_rx(_opcode, ctx, buf);				\
+		_handler(model, ctx, buf);				\
+	}
+
+#define MODEL_OP_ENTRY(_opcode, _min_len, _handler)			\
+	{ _opcode, _min_len, _handler##_rx },
+
+#define MODEL_HANDLERS_DECL(_id, _name, _pub)				\
+	MODEL_OPS_##_name(MODEL_OP_HANDLER_DECL)
+
+#define MODEL_OP_TABLE(_id, _name, _pub)				\
+	MODEL_OPS_##_name(MODEL_OP_RX_WRAPPER)				\
+	static const struct bt_mesh_model_op _name##_op[] = {		\
+		MODEL_OPS_##_name(MODEL_OP_ENTRY)			\
+		BT_MESH_MODEL_OP_END,					\
+	};
+
+#define MODEL_SIG_ENTRY(_id, _name, _pub)				\
+	BT_MESH_MODEL(_id, _name##_op, _pub, NULL),
+
+#define MODEL_VND_ENTRY(_id, _name, _pub)				\
+	BT_MESH_MODEL_VND(CID_NORDIC, _id, _name##_op, _pub, NULL),
+
+#endif	/* __FOTA_MESH_MODELS_H__ */
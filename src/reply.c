@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define SYS_LOG_DOMAIN "fota/reply"
+#define SYS_LOG_LEVEL CONFIG_SYS_LOG_FOTA_LEVEL
+#include <logging/sys_log.h>
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr.h>
+
+#include <bluetooth/mesh.h>
+
+#include "timer_wheel.h"
+#include "health.h"
+#include "telemetry.h"
+#include "reply.h"
+
+struct reply {
+	struct wheel_timer timer;
+	struct bt_mesh_model *model;
+	struct bt_mesh_msg_ctx ctx;
+	bool busy;
+
+	/* Same layout as NET_BUF_SIMPLE(): data must follow msg */
+	struct net_buf_simple msg;
+	u8_t data[REPLY_MSG_SIZE];
+};
+
+static struct reply replies[CONFIG_APP_REPLY_POOL_SIZE];
+static struct reply_stats stats;
+
+static void reply_release(struct reply *reply)
+{
+	int key;
+
+	key = irq_lock();
+	reply->busy = false;
+	stats.in_use--;
+	irq_unlock(key);
+}
+
+static void reply_expiry(struct wheel_timer *timer)
+{
+	struct reply *reply = CONTAINER_OF(timer, struct reply, timer);
+	int err;
+
+	SYS_LOG_DBG("Remote Address: %x, Send TTL: %d",
+		    reply->ctx.addr, reply->ctx.send_ttl);
+
+	err = bt_mesh_model_send(reply->model, &reply->ctx, &reply->msg,
+				 NULL, NULL);
+	if (err) {
+		SYS_LOG_ERR("Unable to send reply message (err %d)", err);
+		stats.send_failed++;
+		if (err == -ENOBUFS) {
+			telemetry_count(TELEMETRY_ADV_STARVED);
+			health_fault_raise(HEALTH_FAULT_ADV_STARVED);
+		}
+	} else {
+		stats.sent++;
+		telemetry_count(TELEMETRY_TX);
+	}
+
+	reply_release(reply);
+}
+
+static struct reply *reply_alloc(void)
+{
+	struct reply *reply = NULL;
+	int key;
+	int i;
+
+	key = irq_lock();
+
+	for (i = 0; i < ARRAY_SIZE(replies); i++) {
+		if (!replies[i].busy) {
+			reply = &replies[i];
+			reply->busy = true;
+			stats.in_use++;
+			stats.in_use_max = max(stats.in_use_max, stats.in_use);
+			break;
+		}
+	}
+
+	irq_unlock(key);
+
+	return reply;
+}
+
+int reply_send(struct bt_mesh_model *model, struct bt_mesh_msg_ctx *ctx,
+	       struct net_buf_simple *msg, u32_t delay_ms)
+{
+	struct reply *reply;
+
+	/* The original buffer size accounts for the TransMIC */
+	if (msg->size > REPLY_MSG_SIZE) {
+		return -EMSGSIZE;
+	}
+
+	reply = reply_alloc();
+	if (!reply) {
+		SYS_LOG_WRN("Reply pool exhausted");
+		stats.pool_exhausted++;
+		health_fault_raise(HEALTH_FAULT_REPLY_EXHAUSTED);
+		return -ENOMEM;
+	}
+
+	reply->model = model;
+	memcpy(&reply->ctx, ctx, sizeof(reply->ctx));
+	net_buf_simple_init(&reply->msg, 0);
+	net_buf_simple_add_mem(&reply->msg, msg->data, msg->len);
+
+	stats.scheduled++;
+	wheel_timer_arm(&reply->timer, delay_ms, 0);
+
+	return 0;
+}
+
+const struct reply_stats *reply_stats_get(void)
+{
+	return &stats;
+}
+
+void reply_init(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(replies); i++) {
+		replies[i].msg.size = sizeof(replies[i].data);
+		wheel_timer_init(&replies[i].timer, reply_expiry);
+	}
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __FOTA_REPLY_H__
+#define __FOTA_REPLY_H__
+
+/**
+ * @file
+ * @brief Delayed mesh model replies
+ *
+ * Status replies are sent after a random delay, so nodes answering the
+ * same group message don't all transmit at once. Instead of sleeping
+ * in the model handler, the reply is copied to one of
+ * CONFIG_APP_REPLY_POOL_SIZE preallocated slots and sent from a timer
+ * wheel callback.
+ */
+
+#include <zephyr/types.h>
+#include <bluetooth/mesh.h>
+
+#include "telemetry.h"
+
+/*
+ * Largest replies (opcode, parameters and TransMIC): the Scene Register
+ * Status, listing every stored scene, and the Telemetry Status.
+ */
+#define REPLY_SCENE_REG_SIZE	(2 + 3 + 2 * CONFIG_APP_SCENE_COUNT + 4)
+#define REPLY_TELEMETRY_SIZE	(3 + TELEMETRY_SNAPSHOT_MAX + 4)
+
+#define REPLY_MSG_SIZE	max(REPLY_SCENE_REG_SIZE, REPLY_TELEMETRY_SIZE)
+
+struct reply_stats {
+	u32_t scheduled;
+	u32_t sent;
+	u32_t send_failed;
+	u32_t pool_exhausted;	/* replies dropped for lack of a slot */
+	u8_t in_use;		/* slots currently pending */
+	u8_t in_use_max;	/* high-water mark of the above */
+};
+
+/**
+ * @brief Initialize the reply pool.
+ *
+ * Must be called after timer_wheel_init().
+ */
+void reply_init(void);
+
+/**
+ * @brief Schedule a reply.
+ *
+ * The message is copied, so it may live on the caller's stack.
+ *
+ * @param model    Model sending the reply.
+ * @param ctx      Message context to send with.
+ * @param msg      Message, with room for the TransMIC.
+ * @param delay_ms Delay before sending.
+ * @return 0 on success, -ENOMEM if the pool is exhausted, -EMSGSIZE if
+ *         the message does not fit a slot.
+ */
+int reply_send(struct bt_mesh_model *model, struct bt_mesh_msg_ctx *ctx,
+	       struct net_buf_simple *msg, u32_t delay_ms);
+
+/**
+ * @brief Get reply statistics.
+ * @return Pointer to the statistics.
+ */
+const struct reply_stats *reply_stats_get(void);
+
+#endif	/* __FOTA_REPLY_H__ */
@@ -0,0 +1,320 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define SYS_LOG_DOMAIN "fota/scene"
+#define SYS_LOG_LEVEL CONFIG_SYS_LOG_FOTA_LEVEL
+#include <logging/sys_log.h>
+
+#include <stddef.h>
+#include <errno.h>
+#include <string.h>
+#include <crc16.h>
+#include <flash.h>
+#include <zephyr.h>
+
+#include "app_work_queue.h"
+#include "health.h"
+#include "mcuboot.h"
+#include "scene.h"
+
+/*
+ * The table is stored in the application state partition as a log of
+ * complete table records; the valid record with the highest sequence
+ * number wins. The partition is split into CONFIG_APP_SCENE_BANKS
+ * banks, each of which must be erasable on its own. Records are
+ * appended to the active bank; once it is full, the next bank is
+ * erased and the log continues there. The records of the previous
+ * bank stay intact until the new one holds a record, so losing power
+ * during the erase loses no scene. With a single bank, the table is
+ * only held in RAM while the bank is erased and rewritten.
+ */
+#define SCENE_AREA_OFFSET	FLASH_AREA_APPLICATION_STATE_OFFSET
+#define SCENE_AREA_SIZE		FLASH_AREA_APPLICATION_STATE_SIZE
+#define SCENE_BANKS		CONFIG_APP_SCENE_BANKS
+#define SCENE_BANK_SIZE		(SCENE_AREA_SIZE / SCENE_BANKS)
+
+#if (SCENE_AREA_SIZE % SCENE_BANKS)
+#error "The application state partition must split into equal banks"
+#endif
+
+#define SCENE_MAGIC		0x53434e31 /* "SCN1" */
+
+/* Records are padded to a multiple of the largest write alignment */
+#define RECORD_ALIGN		8
+#define RECORD_SIZE		ROUND_UP(sizeof(struct scene_record), \
+					 RECORD_ALIGN)
+
+#define ERASED_WORD		0xffffffff
+
+struct scene_entry {
+	u16_t number;
+	u8_t levels[SCENE_CHANNELS];
+};
+
+struct scene_record {
+	u32_t magic;
+	u32_t seq;
+	struct scene_entry entries[CONFIG_APP_SCENE_COUNT];
+	u16_t crc;
+};
+
+union scene_slot {
+	struct scene_record rec;
+	u8_t raw[RECORD_SIZE];
+	u32_t words[RECORD_SIZE / 4];
+};
+
+/*
+ * The table is changed by mesh model handlers and written back from
+ * the application work queue: both hold table_lock, and the flush
+ * handler works on a snapshot.
+ */
+static struct scene_record table;
+static K_MUTEX_DEFINE(table_lock);
+
+/* Flush snapshot, and record buffer while loading */
+static union scene_slot slot;
+
+/* Write position: bank, and offset in that bank of the next slot */
+static u8_t bank;
+static u32_t next_offset;
+static struct k_delayed_work flush_work;
+
+static u16_t record_crc(const struct scene_record *rec)
+{
+	return crc16_ccitt((const u8_t *)rec,
+			   offsetof(struct scene_record, crc));
+}
+
+static u32_t slot_addr(u8_t slot_bank, u32_t offset)
+{
+	return SCENE_AREA_OFFSET + slot_bank * SCENE_BANK_SIZE + offset;
+}
+
+static bool slot_erased(const union scene_slot *buf)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(buf->words); i++) {
+		if (buf->words[i] != ERASED_WORD) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static struct scene_entry *entry_find(u16_t number)
+{
+	int i;
+
+	for (i = 0; i < CONFIG_APP_SCENE_COUNT; i++) {
+		if (table.entries[i].number == number) {
+			return &table.entries[i];
+		}
+	}
+
+	return NULL;
+}
+
+static void flush_handler(struct k_work *work)
+{
+	u32_t start = k_uptime_get_32();
+	u8_t next_bank;
+	int ret;
+
+	k_mutex_lock(&table_lock, K_FOREVER);
+	table.magic = SCENE_MAGIC;
+	table.seq++;
+	table.crc = record_crc(&table);
+	memset(&slot, 0, sizeof(slot));
+	memcpy(&slot.rec, &table, sizeof(table));
+	k_mutex_unlock(&table_lock);
+
+	flash_write_protection_set(flash_dev, false);
+
+	if (next_offset + RECORD_SIZE > SCENE_BANK_SIZE) {
+		next_bank = (bank + 1) % SCENE_BANKS;
+		ret = flash_erase(flash_dev, slot_addr(next_bank, 0),
+				  SCENE_BANK_SIZE);
+		if (ret) {
+			SYS_LOG_ERR("Failed to erase scene bank %u (err %d)",
+				    next_bank, ret);
+			goto out;
+		}
+
+		health_flash_erased(SCENE_BANK_SIZE,
+				    k_uptime_get_32() - start);
+		bank = next_bank;
+		next_offset = 0;
+	}
+
+	ret = flash_write(flash_dev, slot_addr(bank, next_offset),
+			  slot.raw, RECORD_SIZE);
+
+	/* Even a failed write may have left the slot partly programmed */
+	next_offset += RECORD_SIZE;
+
+	if (ret) {
+		SYS_LOG_ERR("Failed to write scene table (err %d)", ret);
+		goto out;
+	}
+
+	SYS_LOG_DBG("Scene table %u written in %u ms", slot.rec.seq,
+		    k_uptime_get_32() - start);
+
+out:
+	flash_write_protection_set(flash_dev, true);
+}
+
+static void flush_schedule(void)
+{
+	/* Restart the timer: a burst of changes is written only once */
+	app_wq_submit_delayed(&flush_work, CONFIG_APP_SCENE_FLUSH_DELAY);
+}
+
+int scene_get(u16_t number, u8_t *levels)
+{
+	struct scene_entry *entry;
+
+	if (number == SCENE_NONE) {
+		return -ENOENT;
+	}
+
+	k_mutex_lock(&table_lock, K_FOREVER);
+
+	entry = entry_find(number);
+	if (entry) {
+		memcpy(levels, entry->levels, sizeof(entry->levels));
+	}
+
+	k_mutex_unlock(&table_lock);
+
+	return entry ? 0 : -ENOENT;
+}
+
+int scene_store(u16_t number, const u8_t *levels)
+{
+	struct scene_entry *entry;
+	int ret = 0;
+
+	if (number == SCENE_NONE) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&table_lock, K_FOREVER);
+
+	entry = entry_find(number);
+	if (!entry) {
+		entry = entry_find(SCENE_NONE);
+	}
+
+	if (!entry) {
+		ret = -ENOMEM;
+	} else if (entry->number != number ||
+		   memcmp(entry->levels, levels, sizeof(entry->levels))) {
+		entry->number = number;
+		memcpy(entry->levels, levels, sizeof(entry->levels));
+		flush_schedule();
+	}
+
+	k_mutex_unlock(&table_lock);
+
+	return ret;
+}
+
+int scene_delete(u16_t number)
+{
+	struct scene_entry *entry;
+
+	if (number == SCENE_NONE) {
+		return -ENOENT;
+	}
+
+	k_mutex_lock(&table_lock, K_FOREVER);
+
+	entry = entry_find(number);
+	if (entry) {
+		memset(entry, 0, sizeof(*entry));
+		flush_schedule();
+	}
+
+	k_mutex_unlock(&table_lock);
+
+	return entry ? 0 : -ENOENT;
+}
+
+int scene_list(u16_t *numbers, int max)
+{
+	int i, count = 0;
+
+	k_mutex_lock(&table_lock, K_FOREVER);
+
+	for (i = 0; i < CONFIG_APP_SCENE_COUNT && count < max; i++) {
+		if (table.entries[i].number != SCENE_NONE) {
+			numbers[count++] = table.entries[i].number;
+		}
+	}
+
+	k_mutex_unlock(&table_lock);
+
+	return count;
+}
+
+int scene_init(void)
+{
+	bool found = false;
+	u32_t offset, end;
+	u8_t b;
+
+	k_delayed_work_init(&flush_work, flush_handler);
+	memset(&table, 0, sizeof(table));
+
+	bank = 0;
+	next_offset = 0;
+
+	for (b = 0; b < SCENE_BANKS; b++) {
+		end = 0;
+
+		for (offset = 0; offset + RECORD_SIZE <= SCENE_BANK_SIZE;
+		     offset += RECORD_SIZE) {
+			if (flash_read(flash_dev, slot_addr(b, offset),
+				       slot.raw, RECORD_SIZE)) {
+				SYS_LOG_ERR("Failed to read scene area");
+				return -EIO;
+			}
+
+			if (slot_erased(&slot)) {
+				continue;
+			}
+
+			/*
+			 * Torn or otherwise invalid records are skipped,
+			 * but no record is ever written over them.
+			 */
+			end = offset + RECORD_SIZE;
+
+			if (slot.rec.magic != SCENE_MAGIC ||
+			    slot.rec.crc != record_crc(&slot.rec)) {
+				continue;
+			}
+
+			if (!found || (s32_t)(slot.rec.seq - table.seq) > 0) {
+				memcpy(&table, &slot.rec, sizeof(table));
+				bank = b;
+				found = true;
+			}
+		}
+
+		if (b == bank) {
+			next_offset = end;
+		}
+	}
+
+	SYS_LOG_INF("Scene table loaded (seq %u, bank %u)", table.seq, bank);
+
+	return 0;
+}
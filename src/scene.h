@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __FOTA_SCENE_H__
+#define __FOTA_SCENE_H__
+
+/**
+ * @file
+ * @brief Flash-backed scene table
+ *
+ * Fixed-size table holding the level of every light channel for each
+ * stored scene number. The table is mirrored in RAM, so recalling a
+ * scene never touches flash. Changes are batched: the table is written
+ * back as a single record on the application work queue, some time
+ * after the last change. The functions below may be called from any
+ * thread.
+ */
+
+#include <zephyr/types.h>
+
+/* One level per PWM channel (white only for now) */
+#define SCENE_CHANNELS		1
+
+/* Scene number 0 is prohibited, and used for "no scene" */
+#define SCENE_NONE		0x0000
+
+/**
+ * @brief Load the scene table from flash.
+ * @return 0 on success, negative errno otherwise (the table is then
+ *         empty).
+ */
+int scene_init(void);
+
+/**
+ * @brief Look up a scene.
+ * @param number Scene number.
+ * @param levels Array receiving the SCENE_CHANNELS levels of the scene.
+ * @return 0 on success, -ENOENT if it is not stored.
+ */
+int scene_get(u16_t number, u8_t *levels);
+
+/**
+ * @brief Store (or overwrite) a scene.
+ * @param number Scene number.
+ * @param levels SCENE_CHANNELS levels.
+ * @return 0 on success, -ENOMEM if the table is full, -EINVAL for
+ *         the prohibited scene number.
+ */
+int scene_store(u16_t number, const u8_t *levels);
+
+/**
+ * @brief Delete a scene.
+ * @param number Scene number.
+ * @return 0 on success, -ENOENT if it is not stored.
+ */
+int scene_delete(u16_t number);
+
+/**
+ * @brief List stored scene numbers.
+ * @param numbers Array receiving the scene numbers.
+ * @param max     Size of the array.
+ * @return Number of scene numbers written.
+ */
+int scene_list(u16_t *numbers, int max);
+
+#endif	/* __FOTA_SCENE_H__ */
@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr.h>
+#include <misc/byteorder.h>
+
+#include "reply.h"
+#include "telemetry.h"
+
+/* Latency histogram: bucket i counts latencies below 2^(i + 6) us */
+#define LATENCY_BUCKETS		12
+#define LATENCY_MIN_SHIFT	6
+
+#define MSG_CACHE_SIZE		CONFIG_BT_MESH_MSG_CACHE_SIZE
+
+/* Fields below the gauges are delta-encoded */
+#define DELTA_FIELDS		TELEMETRY_REPLY_IN_USE_MAX
+
+static atomic_t counters[TELEMETRY_COUNTERS];
+
+static u32_t latency_hist[LATENCY_BUCKETS];
+
+/* Receive times of the last MSG_CACHE_SIZE messages */
+static u32_t rx_times[MSG_CACHE_SIZE];
+static u8_t rx_next;
+static u8_t rx_filled;
+static u32_t cache_turnover = UINT32_MAX;
+
+/* Last snapshot sent, for delta encoding */
+static u32_t baseline[DELTA_FIELDS];
+static u8_t baseline_seq;
+
+void telemetry_count(enum telemetry_field counter)
+{
+	atomic_inc(&counters[counter]);
+}
+
+u32_t telemetry_get(enum telemetry_field counter)
+{
+	return atomic_get(&counters[counter]);
+}
+
+void telemetry_rx(void)
+{
+	u32_t now = k_uptime_get_32();
+	int key;
+
+	telemetry_count(TELEMETRY_RX);
+
+	key = irq_lock();
+
+	if (rx_filled) {
+		cache_turnover = min(cache_turnover, now - rx_times[rx_next]);
+	}
+
+	rx_times[rx_next] = now;
+	if (++rx_next == MSG_CACHE_SIZE) {
+		rx_next = 0;
+		rx_filled = 1;
+	}
+
+	irq_unlock(key);
+}
+
+void telemetry_wq_latency(u32_t us)
+{
+	int i;
+
+	for (i = 0; i < LATENCY_BUCKETS - 1; i++) {
+		if (us < BIT(i + LATENCY_MIN_SHIFT)) {
+			break;
+		}
+	}
+
+	latency_hist[i]++;
+}
+
+/* Upper bound of the bucket holding the given percentile, 0 if empty */
+static u32_t latency_percentile(u32_t total, u32_t percent)
+{
+	u32_t sum = 0;
+	int i;
+
+	for (i = 0; i < LATENCY_BUCKETS; i++) {
+		sum += latency_hist[i];
+		if (sum && sum * 100 >= total * percent) {
+			return BIT(i + LATENCY_MIN_SHIFT);
+		}
+	}
+
+	return 0;
+}
+
+static void put_varint(struct net_buf_simple *msg, u32_t value)
+{
+	do {
+		if (value < 0x80) {
+			net_buf_simple_add_u8(msg, value);
+		} else {
+			net_buf_simple_add_u8(msg, (value & 0x7f) | 0x80);
+		}
+		value >>= 7;
+	} while (value);
+}
+
+void telemetry_snapshot(struct net_buf_simple *msg, u8_t ack_seq)
+{
+	const struct reply_stats *reply = reply_stats_get();
+	u32_t values[TELEMETRY_FIELDS];
+	u32_t present;
+	u32_t total = 0;
+	bool delta;
+	u8_t seq;
+	u8_t *bitmap;
+	int i;
+
+	for (i = 0; i < TELEMETRY_COUNTERS; i++) {
+		values[i] = atomic_get(&counters[i]);
+	}
+	values[TELEMETRY_REPLY_SCHEDULED] = reply->scheduled;
+	values[TELEMETRY_REPLY_EXHAUSTED] = reply->pool_exhausted;
+	values[TELEMETRY_REPLY_IN_USE_MAX] = reply->in_use_max;
+	values[TELEMETRY_MSG_CACHE_TURNOVER] = cache_turnover;
+
+	for (i = 0; i < LATENCY_BUCKETS; i++) {
+		total += latency_hist[i];
+	}
+	values[TELEMETRY_WQ_P50] = latency_percentile(total, 50);
+	values[TELEMETRY_WQ_P90] = latency_percentile(total, 90);
+	values[TELEMETRY_WQ_P99] = latency_percentile(total, 99);
+
+	present = BIT_MASK(TELEMETRY_FIELDS);
+	if (cache_turnover == UINT32_MAX) {
+		present &= ~BIT(TELEMETRY_MSG_CACHE_TURNOVER);
+	}
+	if (!total) {
+		present &= ~(BIT(TELEMETRY_WQ_P50) | BIT(TELEMETRY_WQ_P90) |
+			     BIT(TELEMETRY_WQ_P99));
+	}
+
+	delta = baseline_seq && ack_seq == baseline_seq;
+
+	/* 0 is never a valid sequence number */
+	seq = baseline_seq + 1;
+	if (!seq) {
+		seq = 1;
+	}
+
+	net_buf_simple_add_u8(msg, TELEMETRY_VERSION);
+	net_buf_simple_add_u8(msg, delta ? TELEMETRY_FLAG_DELTA : 0);
+	net_buf_simple_add_u8(msg, seq);
+	bitmap = net_buf_simple_add(msg, sizeof(u16_t));
+
+	for (i = 0; i < TELEMETRY_FIELDS; i++) {
+		if (!(present & BIT(i))) {
+			continue;
+		}
+
+		if (delta && i < DELTA_FIELDS) {
+			if (values[i] == baseline[i]) {
+				present &= ~BIT(i);
+				continue;
+			}
+			put_varint(msg, values[i] - baseline[i]);
+		} else {
+			put_varint(msg, values[i]);
+		}
+	}
+
+	sys_put_le16(present, bitmap);
+
+	/* New baseline, and fresh interval for the gauges */
+	memcpy(baseline, values, sizeof(baseline));
+	baseline_seq = seq;
+
+	memset(latency_hist, 0, sizeof(latency_hist));
+	cache_turnover = UINT32_MAX;
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __FOTA_TELEMETRY_H__
+#define __FOTA_TELEMETRY_H__
+
+/**
+ * @file
+ * @brief Mesh performance telemetry
+ *
+ * Counters and latency statistics collected by the application, and
+ * their encoding as a compact, versioned snapshot for the Telemetry
+ * vendor model.
+ *
+ * Snapshot (version 1), all fields little-endian:
+ *
+ *   version (1), flags (1), sequence (1), field bitmap (2),
+ *   then one unsigned LEB128 value per bit set in the bitmap, in
+ *   ascending bit order.
+ *
+ * With TELEMETRY_FLAG_DELTA set, counter fields hold the increase since
+ * the snapshot whose sequence number the requester acknowledged, and
+ * unchanged counters are left out. Gauge fields (see below) are always
+ * absolute. Latency and cache gauges cover the time since the previous
+ * snapshot.
+ */
+
+#include <zephyr/types.h>
+#include <net/buf.h>
+
+#define TELEMETRY_VERSION	1
+#define TELEMETRY_FLAG_DELTA	BIT(0)
+
+/* Largest snapshot: 5 header bytes and 5 bytes per field */
+#define TELEMETRY_SNAPSHOT_MAX	(5 + 5 * TELEMETRY_FIELDS)
+
+enum telemetry_field {
+	/* Counters */
+	TELEMETRY_RX,			/* access messages received */
+	TELEMETRY_TX,			/* replies and publications sent */
+	TELEMETRY_DUP,			/* retransmissions dropped */
+	TELEMETRY_ADV_STARVED,		/* sends failing for lack of
+					 * advertising buffers
+					 */
+	TELEMETRY_PUB_SUPPRESSED,	/* publications merged or skipped */
+	TELEMETRY_TID_EVICTED,		/* live transactions evicted */
+	TELEMETRY_REPLY_SCHEDULED,
+	TELEMETRY_REPLY_EXHAUSTED,	/* replies dropped, pool full */
+
+	/* Gauges */
+	TELEMETRY_REPLY_IN_USE_MAX,
+	TELEMETRY_MSG_CACHE_TURNOVER,	/* shortest time (ms) to receive
+					 * MSG_CACHE_SIZE messages
+					 */
+	TELEMETRY_WQ_P50,		/* work queue latency (us) */
+	TELEMETRY_WQ_P90,
+	TELEMETRY_WQ_P99,
+
+	TELEMETRY_FIELDS,
+};
+
+/* Counters kept by this module, the others are collected on demand */
+#define TELEMETRY_COUNTERS	TELEMETRY_REPLY_SCHEDULED
+
+/**
+ * @brief Increment a counter.
+ * @param counter Counter, below TELEMETRY_COUNTERS.
+ */
+void telemetry_count(enum telemetry_field counter);
+
+/**
+ * @brief Read a counter.
+ * @param counter Counter, below TELEMETRY_COUNTERS.
+ * @return Counter value.
+ */
+u32_t telemetry_get(enum telemetry_field counter);
+
+/**
+ * @brief Account for a received access message.
+ */
+void telemetry_rx(void);
+
+/**
+ * @brief Account for work queue latency.
+ * @param us Time between work becoming due and running, in us.
+ */
+void telemetry_wq_latency(u32_t us);
+
+/**
+ * @brief Append a snapshot to a message.
+ *
+ * @param msg     Message to append to, with TELEMETRY_SNAPSHOT_MAX bytes
+ *                of tailroom.
+ * @param ack_seq Sequence number of the last snapshot received by the
+ *                requester; a delta snapshot is sent if it matches.
+ */
+void telemetry_snapshot(struct net_buf_simple *msg, u8_t ack_seq);
+
+#endif	/* __FOTA_TELEMETRY_H__ */
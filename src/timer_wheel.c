@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr.h>
+#include <misc/dlist.h>
+
+#include "app_work_queue.h"
+#include "health.h"
+#include "telemetry.h"
+#include "timer_wheel.h"
+
+#define WHEEL_TICK	CONFIG_APP_TIMER_WHEEL_TICK
+#define WHEEL_SLOTS	CONFIG_APP_TIMER_WHEEL_SLOTS
+#define WHEEL_MASK	(WHEEL_SLOTS - 1)
+
+#if WHEEL_SLOTS & WHEEL_MASK
+#error "CONFIG_APP_TIMER_WHEEL_SLOTS must be a power of two"
+#endif
+
+static sys_dlist_t slots[WHEEL_SLOTS];
+static s64_t wheel_base;	/* uptime of tick 0, in ms */
+static u32_t wheel_now;		/* last processed tick */
+static u32_t armed_count;
+
+/*
+ * The kernel timer is one-shot, set for the next tick holding a timer
+ * which is due, so an idle wheel does not wake up the CPU every tick.
+ */
+static struct k_timer tick_timer;
+static struct k_work tick_work;
+static bool tick_running;
+static u32_t tick_next;		/* tick the kernel timer is set for */
+static u32_t tick_due;		/* cycle count of the kernel timer expiry */
+
+/* Time elapsed since tick 0, in ms */
+static s64_t wheel_elapsed(void)
+{
+	return k_uptime_get() - wheel_base;
+}
+
+/* Tick the current time falls in */
+static u32_t current_tick(void)
+{
+	return wheel_elapsed() / WHEEL_TICK;
+}
+
+/* Kernel timer expiry, in ISR context */
+static void tick_expiry(struct k_timer *timer)
+{
+	tick_due = k_cycle_get_32();
+	app_wq_submit(&tick_work);
+}
+
+/*
+ * Set the kernel timer for the earliest tick at which a timer expires,
+ * or stop it if none is armed. Must be called with interrupts locked.
+ */
+static void tick_schedule(void)
+{
+	struct wheel_timer *timer;
+	sys_dlist_t *slot;
+	u32_t next = 0, due;
+	s64_t elapsed;
+	s32_t delay;
+	int d;
+
+	/* A timer in slot d, after r more rounds, is due at d + r x slots */
+	for (d = 1; d <= WHEEL_SLOTS; d++) {
+		slot = &slots[(wheel_now + d) & WHEEL_MASK];
+
+		SYS_DLIST_FOR_EACH_CONTAINER(slot, timer, node) {
+			due = wheel_now + d + timer->rounds * WHEEL_SLOTS;
+			if (!next || (s32_t)(due - next) < 0) {
+				next = due;
+			}
+		}
+
+		/* Nothing later in the scan can come before this round */
+		if (next && (s32_t)(next - (wheel_now + d)) <= 0) {
+			break;
+		}
+	}
+
+	/* Nothing armed, or all armed timers are expiring right now */
+	if (!next) {
+		k_timer_stop(&tick_timer);
+		tick_running = false;
+		return;
+	}
+
+	tick_running = true;
+	tick_next = next;
+
+	elapsed = wheel_elapsed();
+	delay = (s32_t)(next - (u32_t)(elapsed / WHEEL_TICK)) * WHEEL_TICK -
+		elapsed % WHEEL_TICK;
+	if (delay > 0) {
+		k_timer_start(&tick_timer, delay, 0);
+	} else {
+		/* Already due: run the wheel right away */
+		k_timer_stop(&tick_timer);
+		tick_due = k_cycle_get_32();
+		app_wq_submit(&tick_work);
+	}
+}
+
+static void tick_handler(struct k_work *work)
+{
+	sys_dlist_t expired;
+	struct wheel_timer *timer, *next;
+	sys_dlist_t *slot;
+	u32_t now;
+	u32_t latency_us;
+	int key;
+
+	sys_dlist_init(&expired);
+
+	key = irq_lock();
+
+	/* How long the expiry waited for the work queue */
+	latency_us = SYS_CLOCK_HW_CYCLES_TO_NS(k_cycle_get_32() - tick_due) /
+		     NSEC_PER_USEC;
+	telemetry_wq_latency(latency_us);
+
+	/* Catch up with every tick elapsed since the last run */
+	now = current_tick();
+	while ((s32_t)(now - wheel_now) > 0) {
+		wheel_now++;
+		slot = &slots[wheel_now & WHEEL_MASK];
+
+		SYS_DLIST_FOR_EACH_CONTAINER_SAFE(slot, timer, next, node) {
+			if (timer->rounds) {
+				timer->rounds--;
+				continue;
+			}
+
+			sys_dlist_remove(&timer->node);
+			sys_dlist_append(&expired, &timer->node);
+		}
+	}
+
+	irq_unlock(key);
+
+	health_wq_latency(latency_us);
+
+	/* Run the whole batch, callbacks may re-arm their timer */
+	while (1) {
+		key = irq_lock();
+
+		timer = SYS_DLIST_PEEK_HEAD_CONTAINER(&expired, timer, node);
+		if (!timer) {
+			irq_unlock(key);
+			break;
+		}
+
+		sys_dlist_remove(&timer->node);
+		timer->armed = false;
+		armed_count--;
+
+		irq_unlock(key);
+
+		timer->fn(timer);
+	}
+
+	key = irq_lock();
+	tick_schedule();
+	irq_unlock(key);
+}
+
+void timer_wheel_init(void)
+{
+	int i;
+
+	for (i = 0; i < WHEEL_SLOTS; i++) {
+		sys_dlist_init(&slots[i]);
+	}
+
+	wheel_base = k_uptime_get();
+	k_timer_init(&tick_timer, tick_expiry, NULL);
+	k_work_init(&tick_work, tick_handler);
+}
+
+void wheel_timer_init(struct wheel_timer *timer, wheel_timer_fn_t fn)
+{
+	timer->fn = fn;
+	timer->armed = false;
+}
+
+void wheel_timer_arm(struct wheel_timer *timer, u32_t delay_ms,
+		     u32_t slack_ms)
+{
+	u32_t ticks, slack, target;
+	int key;
+
+	ticks = max(1, (delay_ms + WHEEL_TICK - 1) / WHEEL_TICK);
+	slack = slack_ms / WHEEL_TICK;
+
+	key = irq_lock();
+
+	if (timer->armed) {
+		sys_dlist_remove(&timer->node);
+	} else if (!armed_count++) {
+		/* Empty wheel: skip the ticks elapsed while it was idle */
+		if (!tick_running) {
+			wheel_now = current_tick();
+		}
+	}
+
+	/* Ticks not processed yet are still ahead of us */
+	target = current_tick() + ticks;
+	if (slack > 1) {
+		/*
+		 * Coalesce on slack-aligned ticks. ROUND_UP() only
+		 * handles powers of two, which slacks rarely are.
+		 */
+		target = ((target + slack - 1) / slack) * slack;
+	}
+
+	timer->rounds = (target - wheel_now - 1) / WHEEL_SLOTS;
+	timer->armed = true;
+	sys_dlist_append(&slots[target & WHEEL_MASK], &timer->node);
+
+	/* Bring the kernel timer forward if this one is due first */
+	if (!tick_running || (s32_t)(target - tick_next) < 0) {
+		tick_schedule();
+	}
+
+	irq_unlock(key);
+}
+
+void wheel_timer_cancel(struct wheel_timer *timer)
+{
+	int key;
+
+	key = irq_lock();
+
+	if (timer->armed) {
+		sys_dlist_remove(&timer->node);
+		timer->armed = false;
+		/*
+		 * The kernel timer is left as is, unless nothing is
+		 * left: expiring with nothing due costs one wake-up.
+		 */
+		if (!--armed_count) {
+			tick_schedule();
+		}
+	}
+
+	irq_unlock(key);
+}
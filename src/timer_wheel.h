@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __FOTA_TIMER_WHEEL_H__
+#define __FOTA_TIMER_WHEEL_H__
+
+/**
+ * @file
+ * @brief Hashed timer wheel for application timeouts
+ *
+ * All application timers share a single one-shot kernel timer, set
+ * for the next tick at which a wheel timer is due: an idle wheel does
+ * not wake the CPU up. Timers hash into one of
+ * CONFIG_APP_TIMER_WHEEL_SLOTS slots by expiry tick, so cancelling is
+ * O(1), arming is O(1) unless the timer becomes the next one due
+ * (then the slots are scanned once), and everything expiring on a
+ * tick is handled in one batch.
+ *
+ * Expiry callbacks run on the application work queue, and may re-arm
+ * their timer. Timers may be armed and cancelled from any thread.
+ */
+
+#include <zephyr.h>
+#include <zephyr/types.h>
+#include <misc/dlist.h>
+
+struct wheel_timer;
+
+/**
+ * @brief Timer expiry callback.
+ * @param timer Expired timer.
+ */
+typedef void (*wheel_timer_fn_t)(struct wheel_timer *timer);
+
+/**
+ * @brief Wheel timer. Fields are private, use the functions below.
+ */
+struct wheel_timer {
+	sys_dnode_t node;
+	wheel_timer_fn_t fn;
+	u32_t rounds;
+	bool armed;
+};
+
+/**
+ * @brief Initialize the timer wheel.
+ *
+ * Must be called after app_wq_init(), and before arming any timer.
+ */
+void timer_wheel_init(void);
+
+/**
+ * @brief Initialize a wheel timer.
+ * @param timer Timer to initialize.
+ * @param fn    Expiry callback.
+ */
+void wheel_timer_init(struct wheel_timer *timer, wheel_timer_fn_t fn);
+
+/**
+ * @brief Arm (or re-arm) a wheel timer.
+ *
+ * The timer expires no earlier than @a delay_ms, rounded up to the
+ * wheel tick. With a non-zero @a slack_ms, the expiry may be pushed
+ * back by up to that much so that it lands on a tick shared with
+ * other timers of the same slack.
+ *
+ * @param timer    Timer to arm.
+ * @param delay_ms Delay in milliseconds.
+ * @param slack_ms Tolerated extra delay in milliseconds.
+ */
+void wheel_timer_arm(struct wheel_timer *timer, u32_t delay_ms,
+		     u32_t slack_ms);
+
+/**
+ * @brief Cancel a wheel timer. Does nothing if it is not armed.
+ * @param timer Timer to cancel.
+ */
+void wheel_timer_cancel(struct wheel_timer *timer);
+
+/**
+ * @brief Check whether a wheel timer is armed.
+ * @param timer Timer to check.
+ * @return true if armed.
+ */
+static inline bool wheel_timer_is_armed(struct wheel_timer *timer)
+{
+	return timer->armed;
+}
+
+#endif	/* __FOTA_TIMER_WHEEL_H__ */
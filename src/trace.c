@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr.h>
+#include <misc/printk.h>
+#include <misc/byteorder.h>
+
+#include "app_work_queue.h"
+#include "trace.h"
+
+#define RING_SIZE	CONFIG_APP_TRACE_BUF_SIZE
+
+/* Byte counters wrap around: the modulo must divide 2^32 */
+#if RING_SIZE & (RING_SIZE - 1)
+#error "CONFIG_APP_TRACE_BUF_SIZE must be a power of two"
+#endif
+
+static u8_t ring[RING_SIZE];
+static u32_t ring_head;		/* total bytes written */
+static u32_t ring_tail;		/* total bytes read */
+static u32_t dropped;
+
+static struct k_work flush_work;
+
+/* Indices wrap at 2^32, hence the power of two ring size */
+static void ring_put(const u8_t *data, u32_t len)
+{
+	while (len--) {
+		ring[ring_head++ % RING_SIZE] = *data++;
+	}
+}
+
+static u8_t ring_get(void)
+{
+	return ring[ring_tail++ % RING_SIZE];
+}
+
+static void flush_handler(struct k_work *work)
+{
+	u8_t hdr[TRACE_HEADER_SIZE];
+	u32_t lost;
+	u16_t len;
+	bool empty;
+	int key;
+	int i;
+
+	while (1) {
+		key = irq_lock();
+		lost = dropped;
+		dropped = 0;
+		empty = ring_tail == ring_head;
+		irq_unlock(key);
+
+		if (lost) {
+			printk("TRC-DROP:%u\n", lost);
+		}
+
+		if (empty) {
+			break;
+		}
+
+		/*
+		 * Records are added whole and only removed here, so the
+		 * oldest one can be read without holding the lock.
+		 */
+		printk("TRC:");
+		for (i = 0; i < TRACE_HEADER_SIZE; i++) {
+			hdr[i] = ring_get();
+			printk("%02x", hdr[i]);
+		}
+
+		len = sys_get_le16(&hdr[TRACE_HEADER_SIZE - 2]);
+		for (i = 0; i < len; i++) {
+			printk("%02x", ring_get());
+		}
+		printk("\n");
+	}
+}
+
+void trace_rx(u32_t opcode, struct bt_mesh_msg_ctx *ctx,
+	      struct net_buf_simple *buf)
+{
+	u8_t hdr[TRACE_HEADER_SIZE];
+	int key;
+
+	hdr[0] = TRACE_VERSION;
+	sys_put_le32(k_uptime_get_32(), &hdr[1]);
+	sys_put_le32(opcode, &hdr[5]);
+	sys_put_le16(ctx->net_idx, &hdr[9]);
+	sys_put_le16(ctx->app_idx, &hdr[11]);
+	sys_put_le16(ctx->addr, &hdr[13]);
+	sys_put_le16(ctx->recv_dst, &hdr[15]);
+	hdr[17] = ctx->recv_ttl;
+	sys_put_le16(buf->len, &hdr[18]);
+
+	key = irq_lock();
+
+	if (RING_SIZE - (ring_head - ring_tail) < sizeof(hdr) + buf->len) {
+		dropped++;
+	} else {
+		ring_put(hdr, sizeof(hdr));
+		ring_put(buf->data, buf->len);
+	}
+
+	irq_unlock(key);
+
+	app_wq_submit(&flush_work);
+}
+
+void trace_init(void)
+{
+	k_work_init(&flush_work, flush_handler);
+}
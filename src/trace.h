@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __FOTA_TRACE_H__
+#define __FOTA_TRACE_H__
+
+/**
+ * @file
+ * @brief Access message trace capture
+ *
+ * With CONFIG_APP_TRACE, every access message delivered to an
+ * application model is recorded, with its context and reception time,
+ * into a RAM ring buffer. The buffer is drained from the application
+ * work queue to the console, one record per line:
+ *
+ *   TRC:<record, hex encoded>
+ *   TRC-DROP:<number of records lost to a full buffer>
+ *
+ * Records are little-endian:
+ *
+ *   u8  version     TRACE_VERSION
+ *   u32 timestamp   reception uptime, in ms
+ *   u32 opcode
+ *   u16 net_idx
+ *   u16 app_idx
+ *   u16 addr        source address
+ *   u16 recv_dst
+ *   u8  recv_ttl
+ *   u16 len         payload length
+ *   u8  payload[len], without the opcode
+ *
+ * A console log holding such lines can be fed as is to the host
+ * replay benchmark in tools/replay.
+ */
+
+#include <zephyr/types.h>
+#include <bluetooth/mesh.h>
+
+#define TRACE_VERSION		1
+#define TRACE_HEADER_SIZE	20
+
+#ifndef CONFIG_APP_TRACE
+static inline void trace_init(void)
+{
+}
+
+static inline void trace_rx(u32_t opcode, struct bt_mesh_msg_ctx *ctx,
+			    struct net_buf_simple *buf)
+{
+}
+#else
+/**
+ * @brief Initialize trace capture.
+ *
+ * Must be called after app_wq_init().
+ */
+void trace_init(void);
+
+/**
+ * @brief Record a received access message.
+ *
+ * Must be called before the handler consumes the payload.
+ *
+ * @param opcode Message opcode.
+ * @param ctx    Message context.
+ * @param buf    Message payload.
+ */
+void trace_rx(u32_t opcode, struct bt_mesh_msg_ctx *ctx,
+	      struct net_buf_simple *buf);
+#endif	/* !defined(CONFIG_APP_TRACE) */
+
+#endif	/* __FOTA_TRACE_H__ */
@@ -21,10 +21,60 @@
 
 #include <stdarg.h>
 
+#include "health.h"
+
+/*
+ * Console output is synchronous, so a log storm stalls whichever
+ * thread is logging. Past CONFIG_APP_LOG_RATE lines in a second, lines
+ * are dropped and counted instead; 0 disables the limit.
+ */
+#define LOG_RATE	CONFIG_APP_LOG_RATE
+
+static u32_t window_start;
+static u32_t window_lines;
+static u32_t dropped;
+
+/* Returns the number of lines dropped before this one, or -1 to drop */
+static int log_admit(u32_t now)
+{
+	int key;
+	int ret = 0;
+
+	key = irq_lock();
+
+	if (now - window_start >= MSEC_PER_SEC) {
+		window_start = now;
+		window_lines = 0;
+		ret = dropped;
+		dropped = 0;
+	}
+
+	if (window_lines++ >= LOG_RATE) {
+		dropped++;
+		ret = -1;
+	}
+
+	irq_unlock(key);
+
+	return ret;
+}
+
 static void tstamp_log_fn(const char *fmt, ...)
 {
 	va_list ap;
 	u32_t up_ms = k_uptime_get_32();
+	int lost;
+
+	if (LOG_RATE) {
+		lost = log_admit(up_ms);
+		if (lost < 0) {
+			health_fault_raise(HEALTH_FAULT_LOG_DROP);
+			return;
+		}
+		if (lost) {
+			printk("[%07u] <%d log lines dropped>\n", up_ms, lost);
+		}
+	}
 
 	printk("[%07u] ", up_ms);
 
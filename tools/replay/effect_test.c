@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Effect waveform test: plays every effect of src/effect.c through a
+ * recording backend, on the replay clock, and checks the emitted
+ * (tick, channel, level) sequence against the expected one, exactly.
+ *
+ * The expected tables follow from effect_descs[] and
+ * CONFIG_APP_EFFECT_TICK (20 ms in replay_config.h); update both
+ * together.
+ *
+ * Usage: effect_test [-v]
+ *   -v  print the emitted sequence of every case
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <zephyr.h>
+
+#include "effect.h"
+#include "replay.h"
+
+#define TICK		CONFIG_APP_EFFECT_TICK
+#define MAX_EVENTS	64
+
+struct event {
+	u32_t tick;
+	u8_t channel;
+	u8_t level;
+};
+
+struct effect_case {
+	const char *name;
+	u8_t channel;
+	u8_t id;
+	u8_t base;
+	u8_t scale;
+	u32_t ticks;		/* ticks to run after effect_play() */
+	const struct event *expected;
+	int expected_count;
+};
+
+#define EXPECTED(...)						\
+	.expected = (const struct event[]){ __VA_ARGS__ },	\
+	.expected_count = sizeof((const struct event[]){ __VA_ARGS__ }) / \
+			  sizeof(struct event)
+
+#define W	EFFECT_CH_WHITE
+#define S	EFFECT_CH_STATUS
+
+static const struct effect_case cases[] = {
+	{
+		/* 10 ticks on, 10 ticks off */
+		.name = "blink", .channel = W, .id = EFFECT_BLINK,
+		.base = 100, .scale = 1, .ticks = 40,
+		EXPECTED({ 0, W, 100 }, { 10, W, 0 }, { 20, W, 100 },
+			 { 30, W, 0 }, { 40, W, 100 }),
+	},
+	{
+		/* Same table, twice slower, at half level */
+		.name = "blink x2 50%", .channel = W, .id = EFFECT_BLINK,
+		.base = 50, .scale = 2, .ticks = 40,
+		EXPECTED({ 0, W, 50 }, { 20, W, 0 }, { 40, W, 50 }),
+	},
+	{
+		/*
+		 * 16 steps of 6 ticks, 10% to 100% and back; the two
+		 * steps at 100% and the two at 10% emit once.
+		 */
+		.name = "breathe", .channel = W, .id = EFFECT_BREATHE,
+		.base = 100, .scale = 1, .ticks = 102,
+		EXPECTED({ 0, W, 10 }, { 6, W, 22 }, { 12, W, 35 },
+			 { 18, W, 48 }, { 24, W, 61 }, { 30, W, 74 },
+			 { 36, W, 87 }, { 42, W, 100 }, { 54, W, 87 },
+			 { 60, W, 74 }, { 66, W, 61 }, { 72, W, 48 },
+			 { 78, W, 35 }, { 84, W, 22 }, { 90, W, 10 },
+			 { 102, W, 22 }),
+	},
+	{
+		/* 10 ms on rounds up to a whole tick, 90 ms off down to 4 */
+		.name = "strobe", .channel = W, .id = EFFECT_STROBE,
+		.base = 100, .scale = 1, .ticks = 10,
+		EXPECTED({ 0, W, 100 }, { 1, W, 0 }, { 5, W, 100 },
+			 { 6, W, 0 }, { 10, W, 100 }),
+	},
+	{
+		/* 10 periods of 25 + 25 ticks, then back to the base */
+		.name = "identify", .channel = W, .id = EFFECT_IDENTIFY,
+		.base = 80, .scale = 1, .ticks = 550,
+		EXPECTED({ 0, W, 80 }, { 25, W, 0 }, { 50, W, 80 },
+			 { 75, W, 0 }, { 100, W, 80 }, { 125, W, 0 },
+			 { 150, W, 80 }, { 175, W, 0 }, { 200, W, 80 },
+			 { 225, W, 0 }, { 250, W, 80 }, { 275, W, 0 },
+			 { 300, W, 80 }, { 325, W, 0 }, { 350, W, 80 },
+			 { 375, W, 0 }, { 400, W, 80 }, { 425, W, 0 },
+			 { 450, W, 80 }, { 475, W, 0 }, { 500, W, 80 }),
+	},
+	{
+		/* Repeat count applies to the scaled periods */
+		.name = "identify x3", .channel = S, .id = EFFECT_IDENTIFY,
+		.base = 100, .scale = 3, .ticks = 1600,
+		EXPECTED({ 0, S, 100 }, { 75, S, 0 }, { 150, S, 100 },
+			 { 225, S, 0 }, { 300, S, 100 }, { 375, S, 0 },
+			 { 450, S, 100 }, { 525, S, 0 }, { 600, S, 100 },
+			 { 675, S, 0 }, { 750, S, 100 }, { 825, S, 0 },
+			 { 900, S, 100 }, { 975, S, 0 }, { 1050, S, 100 },
+			 { 1125, S, 0 }, { 1200, S, 100 }, { 1275, S, 0 },
+			 { 1350, S, 100 }, { 1425, S, 0 }, { 1500, S, 100 }),
+	},
+	{
+		.name = "provisioned", .channel = S, .id = EFFECT_PROVISIONED,
+		.base = 100, .scale = 1, .ticks = 100,
+		EXPECTED({ 0, S, 100 }, { 50, S, 0 }, { 100, S, 100 }),
+	},
+};
+
+static struct event events[MAX_EVENTS];
+static int event_count;
+static u32_t case_start_ms;
+static bool verbose;
+
+static int recorder_set(u8_t channel, u8_t level)
+{
+	if (event_count == MAX_EVENTS) {
+		fprintf(stderr, "Too many events\n");
+		abort();
+	}
+
+	events[event_count].tick = (replay_now_ms - case_start_ms) / TICK;
+	events[event_count].channel = channel;
+	events[event_count].level = level;
+	event_count++;
+
+	return 0;
+}
+
+static const struct effect_backend recorder = {
+	.set = recorder_set,
+};
+
+static void print_events(const char *what, const struct event *ev,
+			 int count)
+{
+	int i;
+
+	printf("  %s:", what);
+	for (i = 0; i < count; i++) {
+		printf(" %u:%u:%u", ev[i].tick, ev[i].channel, ev[i].level);
+	}
+	printf("\n");
+}
+
+static bool events_equal(const struct event *a, const struct event *b,
+			 int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (a[i].tick != b[i].tick || a[i].channel != b[i].channel ||
+		    a[i].level != b[i].level) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool run_case(const struct effect_case *c)
+{
+	u32_t tick;
+	bool ok;
+
+	event_count = 0;
+	case_start_ms = replay_now_ms;
+
+	effect_play(c->channel, c->id, c->base, c->scale);
+
+	for (tick = 1; tick <= c->ticks; tick++) {
+		replay_now_ms += TICK;
+		replay_run_timers();
+	}
+
+	ok = event_count == c->expected_count &&
+	     events_equal(events, c->expected, event_count);
+
+	printf("%-14s %s\n", c->name, ok ? "ok" : "FAILED");
+	if (!ok) {
+		print_events("expected", c->expected, c->expected_count);
+	}
+	if (!ok || verbose) {
+		print_events("emitted", events, event_count);
+	}
+
+	/* Leave the channel off, outside of the recorded sequence */
+	effect_set(c->channel, 0);
+	replay_now_ms += TICK;
+
+	return ok;
+}
+
+int main(int argc, char **argv)
+{
+	bool played[EFFECT_COUNT] = { };
+	int failed = 0;
+	int opt, i;
+
+	while ((opt = getopt(argc, argv, "v")) != -1) {
+		switch (opt) {
+		case 'v':
+			verbose = true;
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-v]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	effect_init(&recorder);
+
+	for (i = 0; i < ARRAY_SIZE(cases); i++) {
+		failed += !run_case(&cases[i]);
+		played[cases[i].id] = true;
+	}
+
+	for (i = 0; i < EFFECT_COUNT; i++) {
+		if (!played[i]) {
+			printf("effect %d has no test case\n", i);
+			failed++;
+		}
+	}
+
+	printf("%d of %d failed\n", failed, (int)ARRAY_SIZE(cases));
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Host stand-in for the Zephyr header of the same name */
+
+#ifndef __REPLAY_BLUETOOTH_H__
+#define __REPLAY_BLUETOOTH_H__
+
+typedef void (*bt_ready_cb_t)(int err);
+
+int bt_enable(bt_ready_cb_t cb);
+
+#endif	/* __REPLAY_BLUETOOTH_H__ */
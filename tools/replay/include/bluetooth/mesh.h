@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Host stand-in for the Zephyr header of the same name, reduced to
+ * what the application models use. bt_mesh_init() only records the
+ * composition, which the replay then dispatches to.
+ */
+
+#ifndef __REPLAY_BLUETOOTH_MESH_H__
+#define __REPLAY_BLUETOOTH_MESH_H__
+
+#include <zephyr.h>
+#include <net/buf.h>
+
+#define BT_MESH_MODEL_OP_1(b0)		(b0)
+#define BT_MESH_MODEL_OP_2(b0, b1)	(((b0) << 8) | (b1))
+#define BT_MESH_MODEL_OP_3(b0, cid)	((((b0) << 16) | 0xc00000) | (cid))
+
+#define BT_MESH_MODEL_ID_CFG_SRV	0x0000
+#define BT_MESH_MODEL_ID_HEALTH_SRV	0x0002
+#define BT_MESH_MODEL_ID_GEN_ONOFF_SRV	0x1000
+#define BT_MESH_MODEL_ID_SCENE_SRV	0x1203
+#define BT_MESH_MODEL_ID_SCENE_SETUP_SRV 0x1204
+
+#define BT_MESH_RELAY_ENABLED		0x01
+#define BT_MESH_RELAY_NOT_SUPPORTED	0x02
+#define BT_MESH_BEACON_ENABLED		0x01
+#define BT_MESH_GATT_PROXY_ENABLED	0x01
+#define BT_MESH_GATT_PROXY_NOT_SUPPORTED 0x02
+#define BT_MESH_FRIEND_ENABLED		0x01
+#define BT_MESH_FRIEND_NOT_SUPPORTED	0x02
+
+#define BT_MESH_TRANSMIT(count, int_ms)	((count) | (((int_ms / 10) - 1) << 3))
+#define BT_MESH_TRANSMIT_COUNT(transmit)	(((transmit) & (u8_t)BIT_MASK(3)))
+#define BT_MESH_TRANSMIT_INT(transmit)	((((transmit) >> 3) + 1) * 10)
+
+#define BT_MESH_NO_OUTPUT		0
+
+struct bt_mesh_msg_ctx {
+	u16_t net_idx;
+	u16_t app_idx;
+	u16_t addr;
+	u16_t recv_dst;
+	u8_t recv_ttl;
+	u8_t send_ttl;
+};
+
+struct bt_mesh_model;
+
+struct bt_mesh_model_op {
+	u32_t opcode;
+	size_t min_len;
+	void (*func)(struct bt_mesh_model *model,
+		     struct bt_mesh_msg_ctx *ctx,
+		     struct net_buf_simple *buf);
+};
+
+#define BT_MESH_MODEL_OP_END { 0, 0, NULL }
+
+struct bt_mesh_model_pub {
+	struct bt_mesh_model *mod;
+	u16_t addr;
+	struct net_buf_simple *msg;
+	int (*update)(struct bt_mesh_model *mod);
+};
+
+struct bt_mesh_model {
+	union {
+		u16_t id;
+		struct {
+			u16_t company;
+			u16_t id;
+		} vnd;
+	};
+	u8_t elem_idx;
+	struct bt_mesh_model_pub *pub;
+	const struct bt_mesh_model_op *op;
+	void *user_data;
+};
+
+#define BT_MESH_MODEL(_id, _op, _pub, _user_data)			\
+	{ .id = (_id), .op = _op, .pub = _pub, .user_data = _user_data }
+
+#define BT_MESH_MODEL_VND(_company, _id, _op, _pub, _user_data)	\
+	{ .vnd.company = (_company), .vnd.id = (_id), .op = _op,	\
+	  .pub = _pub, .user_data = _user_data }
+
+struct bt_mesh_elem {
+	u16_t addr;
+	u16_t loc;
+	u8_t model_count;
+	u8_t vnd_model_count;
+	struct bt_mesh_model *models;
+	struct bt_mesh_model *vnd_models;
+};
+
+#define BT_MESH_ELEM(_loc, _mods, _vnd_mods)				\
+	{ .loc = (_loc), .model_count = ARRAY_SIZE(_mods),		\
+	  .models = (_mods), .vnd_model_count = ARRAY_SIZE(_vnd_mods),	\
+	  .vnd_models = (_vnd_mods) }
+
+struct bt_mesh_comp {
+	u16_t cid;
+	u16_t pid;
+	u16_t vid;
+	size_t elem_count;
+	struct bt_mesh_elem *elem;
+};
+
+struct bt_mesh_cfg {
+	u8_t net_transmit;
+	u8_t relay;
+	u8_t relay_retransmit;
+	u8_t beacon;
+	u8_t gatt_proxy;
+	u8_t frnd;
+	u8_t default_ttl;
+};
+
+struct bt_mesh_health {
+	struct bt_mesh_model *model;
+	int (*fault_get_cur)(struct bt_mesh_model *model, u8_t *test_id,
+			     u16_t *company_id, u8_t *faults,
+			     u8_t *fault_count);
+	int (*fault_get_reg)(struct bt_mesh_model *model, u16_t company_id,
+			     u8_t *test_id, u8_t *faults, u8_t *fault_count);
+	int (*fault_clear)(struct bt_mesh_model *model, u16_t company_id);
+	int (*fault_test)(struct bt_mesh_model *model, u8_t test_id,
+			  u16_t company_id);
+	void (*attn_on)(struct bt_mesh_model *model);
+	void (*attn_off)(struct bt_mesh_model *model);
+};
+
+#define BT_MESH_MODEL_CFG_SRV(srv)					\
+	BT_MESH_MODEL(BT_MESH_MODEL_ID_CFG_SRV, NULL, NULL, srv)
+#define BT_MESH_MODEL_HEALTH_SRV(srv)					\
+	BT_MESH_MODEL(BT_MESH_MODEL_ID_HEALTH_SRV, NULL, NULL, srv)
+
+struct bt_mesh_prov {
+	const u8_t *uuid;
+	u8_t output_actions;
+	void (*complete)(void);
+};
+
+int bt_mesh_init(const struct bt_mesh_prov *prov,
+		 const struct bt_mesh_comp *comp);
+
+void bt_mesh_model_msg_init(struct net_buf_simple *msg, u32_t opcode);
+int bt_mesh_model_send(struct bt_mesh_model *model,
+		       struct bt_mesh_msg_ctx *ctx,
+		       struct net_buf_simple *msg,
+		       const void *cb, void *cb_data);
+int bt_mesh_model_publish(struct bt_mesh_model *model);
+struct bt_mesh_elem *bt_mesh_model_elem(struct bt_mesh_model *mod);
+int bt_mesh_fault_update(struct bt_mesh_elem *elem);
+
+#endif	/* __REPLAY_BLUETOOTH_MESH_H__ */
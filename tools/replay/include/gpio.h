@@ -0,0 +1,19 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Host stand-in for the Zephyr header of the same name */
+
+#ifndef __REPLAY_GPIO_H__
+#define __REPLAY_GPIO_H__
+
+#include <zephyr.h>
+
+#define GPIO_DIR_OUT	1
+
+int gpio_pin_configure(struct device *port, u32_t pin, int flags);
+int gpio_pin_write(struct device *port, u32_t pin, u32_t value);
+
+#endif	/* __REPLAY_GPIO_H__ */
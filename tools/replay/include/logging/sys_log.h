@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Host stand-in for the Zephyr header of the same name: logging is
+ * compiled out, so that it does not weigh on the measurements.
+ */
+
+#ifndef __REPLAY_LOGGING_SYS_LOG_H__
+#define __REPLAY_LOGGING_SYS_LOG_H__
+
+#define SYS_LOG_LEVEL_ERROR	1
+
+#define SYS_LOG_ERR(...)	do { } while (0)
+#define SYS_LOG_WRN(...)	do { } while (0)
+#define SYS_LOG_INF(...)	do { } while (0)
+#define SYS_LOG_DBG(...)	do { } while (0)
+
+#endif	/* __REPLAY_LOGGING_SYS_LOG_H__ */
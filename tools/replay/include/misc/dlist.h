@@ -0,0 +1,20 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Host stand-in for the Zephyr header of the same name */
+
+#ifndef __REPLAY_MISC_DLIST_H__
+#define __REPLAY_MISC_DLIST_H__
+
+struct _dnode {
+	struct _dnode *next;
+	struct _dnode *prev;
+};
+
+typedef struct _dnode sys_dlist_t;
+typedef struct _dnode sys_dnode_t;
+
+#endif	/* __REPLAY_MISC_DLIST_H__ */
@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Host stand-in for the Zephyr header of the same name */
+
+#ifndef __REPLAY_MISC_PRINTK_H__
+#define __REPLAY_MISC_PRINTK_H__
+
+#include <stdio.h>
+
+#define printk printf
+
+#endif	/* __REPLAY_MISC_PRINTK_H__ */
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Host stand-in for the Zephyr header of the same name */
+
+#ifndef __REPLAY_NET_BUF_H__
+#define __REPLAY_NET_BUF_H__
+
+#include <string.h>
+#include <zephyr.h>
+#include <misc/byteorder.h>
+
+struct net_buf_simple {
+	u8_t *data;
+	u16_t len;
+	u16_t size;
+	u8_t __buf[0] __attribute__((aligned(sizeof(int))));
+};
+
+#define NET_BUF_SIMPLE(_size)						\
+	((struct net_buf_simple *)(&(struct {				\
+		struct net_buf_simple buf;				\
+		u8_t data[_size];					\
+	}) {								\
+		.buf.size = _size,					\
+	}))
+
+static inline void net_buf_simple_init(struct net_buf_simple *buf,
+				       size_t reserve_head)
+{
+	buf->data = buf->__buf + reserve_head;
+	buf->len = 0;
+}
+
+void *net_buf_simple_add(struct net_buf_simple *buf, size_t len);
+void *net_buf_simple_pull(struct net_buf_simple *buf, size_t len);
+
+static inline void *net_buf_simple_add_mem(struct net_buf_simple *buf,
+					   const void *mem, size_t len)
+{
+	return memcpy(net_buf_simple_add(buf, len), mem, len);
+}
+
+static inline u8_t *net_buf_simple_add_u8(struct net_buf_simple *buf,
+					  u8_t val)
+{
+	u8_t *u8 = net_buf_simple_add(buf, 1);
+
+	*u8 = val;
+	return u8;
+}
+
+static inline void net_buf_simple_add_le16(struct net_buf_simple *buf,
+					   u16_t val)
+{
+	sys_put_le16(val, net_buf_simple_add(buf, sizeof(val)));
+}
+
+static inline u8_t net_buf_simple_pull_u8(struct net_buf_simple *buf)
+{
+	return *(u8_t *)net_buf_simple_pull(buf, 1);
+}
+
+static inline u16_t net_buf_simple_pull_le16(struct net_buf_simple *buf)
+{
+	return sys_get_le16(net_buf_simple_pull(buf, sizeof(u16_t)));
+}
+
+static inline size_t net_buf_simple_tailroom(struct net_buf_simple *buf)
+{
+	return buf->size - (buf->data - buf->__buf) - buf->len;
+}
+
+#endif	/* __REPLAY_NET_BUF_H__ */
@@ -0,0 +1,17 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Host stand-in for the Zephyr header of the same name */
+
+#ifndef __REPLAY_PWM_H__
+#define __REPLAY_PWM_H__
+
+#include <zephyr.h>
+
+int pwm_pin_set_usec(struct device *dev, u32_t pwm, u32_t period,
+		     u32_t pulse);
+
+#endif	/* __REPLAY_PWM_H__ */
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Host stand-in for the Zephyr kernel API used by the model code.
+ *
+ * Single threaded: locks are no-ops and work items run synchronously
+ * when submitted. Uptime is the replay clock (the capture timestamps),
+ * cycles are host cycles.
+ */
+
+#ifndef __REPLAY_ZEPHYR_H__
+#define __REPLAY_ZEPHYR_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <zephyr/types.h>
+#include <misc/printk.h>
+
+#define __packed		__attribute__((__packed__))
+#define FUNC_NORETURN
+
+#define ARRAY_SIZE(array)	(sizeof(array) / sizeof((array)[0]))
+#define CONTAINER_OF(ptr, type, field) \
+	((type *)(((char *)(ptr)) - offsetof(type, field)))
+#define BIT(n)			(1UL << (n))
+#define BIT_MASK(n)		(BIT(n) - 1)
+
+#ifndef min
+#define min(a, b)		(((a) < (b)) ? (a) : (b))
+#endif
+#ifndef max
+#define max(a, b)		(((a) > (b)) ? (a) : (b))
+#endif
+
+#define MSEC_PER_SEC		1000
+#define USEC_PER_SEC		1000000
+#define NSEC_PER_USEC		1000
+#define K_MSEC(ms)		(ms)
+#define K_SECONDS(s)		K_MSEC((s) * MSEC_PER_SEC)
+#define K_NO_WAIT		0
+
+/* Host cycles are reported in ns */
+#define SYS_CLOCK_HW_CYCLES_TO_NS(c)	((u32_t)(c))
+#define SYS_CLOCK_HW_CYCLES_TO_NS64(c)	((u64_t)(c))
+
+s64_t k_uptime_get(void);
+u32_t k_uptime_get_32(void);
+u32_t k_cycle_get_32(void);
+u32_t sys_rand32_get(void);
+
+static inline int irq_lock(void)
+{
+	return 0;
+}
+
+static inline void irq_unlock(int key)
+{
+}
+
+static inline void k_sched_lock(void)
+{
+}
+
+static inline void k_sched_unlock(void)
+{
+}
+
+typedef long atomic_t;
+typedef long atomic_val_t;
+
+static inline atomic_val_t atomic_get(const atomic_t *target)
+{
+	return *target;
+}
+
+static inline atomic_val_t atomic_set(atomic_t *target, atomic_val_t value)
+{
+	atomic_val_t old = *target;
+
+	*target = value;
+	return old;
+}
+
+static inline atomic_val_t atomic_inc(atomic_t *target)
+{
+	return (*target)++;
+}
+
+static inline atomic_val_t atomic_dec(atomic_t *target)
+{
+	return (*target)--;
+}
+
+static inline atomic_val_t atomic_clear(atomic_t *target)
+{
+	return atomic_set(target, 0);
+}
+
+static inline bool atomic_test_bit(const atomic_t *target, int bit)
+{
+	return *target & BIT(bit);
+}
+
+static inline void atomic_set_bit(atomic_t *target, int bit)
+{
+	*target |= BIT(bit);
+}
+
+static inline void atomic_clear_bit(atomic_t *target, int bit)
+{
+	*target &= ~BIT(bit);
+}
+
+static inline bool atomic_test_and_set_bit(atomic_t *target, int bit)
+{
+	bool old = atomic_test_bit(target, bit);
+
+	atomic_set_bit(target, bit);
+	return old;
+}
+
+struct k_work;
+typedef void (*k_work_handler_t)(struct k_work *work);
+
+struct k_work {
+	k_work_handler_t handler;
+};
+
+struct k_delayed_work {
+	struct k_work work;
+};
+
+struct k_work_q {
+	int unused;
+};
+
+static inline void k_work_init(struct k_work *work, k_work_handler_t handler)
+{
+	work->handler = handler;
+}
+
+static inline void k_work_submit_to_queue(struct k_work_q *q,
+					  struct k_work *work)
+{
+	work->handler(work);
+}
+
+static inline int k_delayed_work_submit_to_queue(struct k_work_q *q,
+						 struct k_delayed_work *work,
+						 s32_t delay)
+{
+	work->work.handler(&work->work);
+	return 0;
+}
+
+struct device {
+	const char *name;
+};
+
+struct device *device_get_binding(const char *name);
+
+#endif	/* __REPLAY_ZEPHYR_H__ */
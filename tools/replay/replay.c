@@ -0,0 +1,453 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Replay benchmark: feeds a trace capture (see src/trace.h) to the
+ * model handlers of src/main.c, built for the host against stub mesh
+ * and driver layers, and reports throughput, per-handler cost, reply
+ * pool slots taken and reply delays per load level.
+ *
+ * Usage: replay [-p] [-n runs] capture.log
+ *   -p  replay at the recorded pacing instead of as fast as possible
+ *   -n  replay the capture this many times (default 1)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <zephyr.h>
+#include <misc/byteorder.h>
+#include <bluetooth/mesh.h>
+
+#include "reply.h"
+#include "load.h"
+#include "trace.h"
+#include "mesh_models.h"
+#include "replay.h"
+
+/* Handler names, from the same description as the opcode tables */
+struct op_name {
+	u32_t opcode;
+	const char *name;
+};
+
+#define OP_NAME(_opcode, _min_len, _handler)	{ _opcode, #_handler },
+#define MODEL_OP_NAMES(_id, _name, _pub)	MODEL_OPS_##_name(OP_NAME)
+
+static const struct op_name op_names[] = {
+	APP_ROOT_MODELS(MODEL_OP_NAMES)
+	APP_VND_MODELS(MODEL_OP_NAMES)
+};
+
+struct record {
+	u32_t timestamp;
+	u32_t opcode;
+	struct bt_mesh_msg_ctx ctx;
+	u16_t len;
+	u8_t *data;
+};
+
+struct op_stats {
+	u64_t count;
+	u64_t cost;
+	u64_t cost_min;
+	u64_t cost_max;
+	u64_t reply_slots;
+	u64_t pwm_writes;
+};
+
+static struct op_stats stats[ARRAY_SIZE(op_names)];
+static u64_t unhandled;
+
+/* Reply delays, per load level and destination address kind */
+#define DELAY_BUCKET_MS	10
+#define DELAY_BUCKETS	64
+
+enum { DELAY_UNICAST, DELAY_GROUP, DELAY_KINDS };
+
+struct delay_stats {
+	u64_t count;
+	u64_t sum;
+	u32_t min;
+	u32_t max;
+	u32_t hist[DELAY_BUCKETS];
+};
+
+static struct delay_stats delays[LOAD_HIGH + 1][DELAY_KINDS];
+
+static const char *const level_names[] = {
+	[LOAD_LOW] = "low",
+	[LOAD_MEDIUM] = "medium",
+	[LOAD_HIGH] = "high",
+};
+
+u32_t __real_load_reply_delay(struct bt_mesh_msg_ctx *ctx);
+
+/* Linked in place of load_reply_delay(), see Makefile */
+u32_t __wrap_load_reply_delay(struct bt_mesh_msg_ctx *ctx)
+{
+	u32_t delay = __real_load_reply_delay(ctx);
+	bool unicast = ctx->recv_dst && ctx->recv_dst < 0x8000;
+	struct delay_stats *d;
+
+	d = &delays[load_level_get()][unicast ? DELAY_UNICAST : DELAY_GROUP];
+	if (!d->count || delay < d->min) {
+		d->min = delay;
+	}
+	if (delay > d->max) {
+		d->max = delay;
+	}
+	d->count++;
+	d->sum += delay;
+	d->hist[min(delay / DELAY_BUCKET_MS, DELAY_BUCKETS - 1)]++;
+
+	return delay;
+}
+
+/* Upper bound of the bucket holding the given percentile */
+static u32_t delay_percentile(const struct delay_stats *d, int percent)
+{
+	u64_t seen = 0;
+	int i;
+
+	for (i = 0; i < DELAY_BUCKETS - 1; i++) {
+		seen += d->hist[i];
+		if (seen * 100 >= d->count * percent) {
+			break;
+		}
+	}
+
+	return min((i + 1) * DELAY_BUCKET_MS, d->max);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#define COST_UNIT	"cycles"
+
+static inline u64_t cost_now(void)
+{
+	return __rdtsc();
+}
+#else
+#define COST_UNIT	"ns"
+
+static inline u64_t cost_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#endif
+
+static double wall_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int hex_decode(const char *hex, u8_t *out, size_t max)
+{
+	size_t n = 0;
+	unsigned int byte;
+
+	while (n < max && sscanf(hex, "%2x", &byte) == 1) {
+		out[n++] = byte;
+		hex += 2;
+	}
+
+	return n;
+}
+
+static int load_capture(const char *path, struct record **records)
+{
+	static char line[2 * (TRACE_HEADER_SIZE + 0xffff) + 64];
+	u8_t raw[TRACE_HEADER_SIZE + 0xffff];
+	struct record *rec;
+	int count = 0, alloc = 0;
+	char *hex;
+	int len;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+
+	*records = NULL;
+
+	while (fgets(line, sizeof(line), f)) {
+		hex = strstr(line, "TRC:");
+		if (!hex) {
+			if (strstr(line, "TRC-DROP:")) {
+				fprintf(stderr, "warning: capture lost %s",
+					strstr(line, "TRC-DROP:") + 9);
+			}
+			continue;
+		}
+
+		len = hex_decode(hex + 4, raw, sizeof(raw));
+		if (len < TRACE_HEADER_SIZE || raw[0] != TRACE_VERSION ||
+		    len != TRACE_HEADER_SIZE +
+			   sys_get_le16(&raw[TRACE_HEADER_SIZE - 2])) {
+			fprintf(stderr, "warning: bad record skipped\n");
+			continue;
+		}
+
+		if (count == alloc) {
+			alloc = alloc ? 2 * alloc : 256;
+			*records = realloc(*records, alloc * sizeof(**records));
+			if (!*records) {
+				fclose(f);
+				return -1;
+			}
+		}
+
+		rec = &(*records)[count++];
+		rec->timestamp = sys_get_le32(&raw[1]);
+		rec->opcode = sys_get_le32(&raw[5]);
+		memset(&rec->ctx, 0, sizeof(rec->ctx));
+		rec->ctx.net_idx = sys_get_le16(&raw[9]);
+		rec->ctx.app_idx = sys_get_le16(&raw[11]);
+		rec->ctx.addr = sys_get_le16(&raw[13]);
+		rec->ctx.recv_dst = sys_get_le16(&raw[15]);
+		rec->ctx.recv_ttl = raw[17];
+		rec->len = len - TRACE_HEADER_SIZE;
+		rec->data = malloc(rec->len + 1);
+		memcpy(rec->data, &raw[TRACE_HEADER_SIZE], rec->len);
+	}
+
+	fclose(f);
+	return count;
+}
+
+/* Same lookup as the mesh stack: every model of every element */
+static const struct bt_mesh_model_op *find_op(u32_t opcode,
+					      struct bt_mesh_model **model)
+{
+	const struct bt_mesh_model_op *op;
+	struct bt_mesh_elem *elem;
+	struct bt_mesh_model *models;
+	size_t i, j, count;
+	int vnd;
+
+	for (i = 0; i < replay_comp->elem_count; i++) {
+		elem = &replay_comp->elem[i];
+
+		for (vnd = 0; vnd < 2; vnd++) {
+			models = vnd ? elem->vnd_models : elem->models;
+			count = vnd ? elem->vnd_model_count :
+				      elem->model_count;
+
+			for (j = 0; j < count; j++) {
+				for (op = models[j].op; op && op->func; op++) {
+					if (op->opcode == opcode) {
+						*model = &models[j];
+						return op;
+					}
+				}
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static int op_index(u32_t opcode)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(op_names); i++) {
+		if (op_names[i].opcode == opcode) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static void dispatch(const struct record *rec)
+{
+	struct net_buf_simple *buf = NET_BUF_SIMPLE(0xffff);
+	const struct bt_mesh_model_op *op;
+	struct bt_mesh_model *model;
+	struct bt_mesh_msg_ctx ctx = rec->ctx;
+	struct replay_counters before;
+	struct op_stats *s;
+	u32_t scheduled;
+	u64_t start, cost;
+	int idx;
+
+	op = find_op(rec->opcode, &model);
+	idx = op_index(rec->opcode);
+	if (!op || idx < 0 || rec->len < op->min_len) {
+		unhandled++;
+		return;
+	}
+
+	net_buf_simple_init(buf, 0);
+	net_buf_simple_add_mem(buf, rec->data, rec->len);
+
+	before = replay_counters;
+	scheduled = reply_stats_get()->scheduled;
+
+	start = cost_now();
+	op->func(model, &ctx, buf);
+	cost = cost_now() - start;
+
+	s = &stats[idx];
+	if (!s->count || cost < s->cost_min) {
+		s->cost_min = cost;
+	}
+	if (cost > s->cost_max) {
+		s->cost_max = cost;
+	}
+	s->count++;
+	s->cost += cost;
+	s->reply_slots += reply_stats_get()->scheduled - scheduled;
+	s->pwm_writes += replay_counters.pwm_writes - before.pwm_writes;
+}
+
+static void report(u64_t total, double elapsed)
+{
+	const struct reply_stats *reply = reply_stats_get();
+	const struct op_stats *s;
+	int i;
+
+	printf("%llu messages in %.3f s: %.0f msgs/s\n",
+	       (unsigned long long)total, elapsed,
+	       elapsed > 0 ? total / elapsed : 0);
+	if (unhandled) {
+		printf("%llu messages without a handler\n",
+		       (unsigned long long)unhandled);
+	}
+
+	printf("\n%-24s %8s %10s %10s %10s %7s %7s\n", "handler",
+	       "count", "avg " COST_UNIT, "min", "max", "slots", "pwm");
+
+	for (i = 0; i < ARRAY_SIZE(op_names); i++) {
+		s = &stats[i];
+		if (!s->count) {
+			continue;
+		}
+
+		printf("%-24s %8llu %10llu %10llu %10llu %7llu %7llu\n",
+		       op_names[i].name, (unsigned long long)s->count,
+		       (unsigned long long)(s->cost / s->count),
+		       (unsigned long long)s->cost_min,
+		       (unsigned long long)s->cost_max,
+		       (unsigned long long)s->reply_slots,
+		       (unsigned long long)s->pwm_writes);
+	}
+
+	printf("\n%-24s %8s %10s %10s %10s %10s %10s\n", "reply delay (ms)",
+	       "count", "avg", "min", "p50", "p90", "max");
+
+	for (i = 0; i < ARRAY_SIZE(delays) * DELAY_KINDS; i++) {
+		const struct delay_stats *d = &delays[i / DELAY_KINDS]
+						     [i % DELAY_KINDS];
+		char name[32];
+
+		if (!d->count) {
+			continue;
+		}
+
+		snprintf(name, sizeof(name), "%s load, %s",
+			 level_names[i / DELAY_KINDS],
+			 i % DELAY_KINDS == DELAY_UNICAST ? "unicast" : "group");
+		printf("%-24s %8llu %10llu %10u %10u %10u %10u\n", name,
+		       (unsigned long long)d->count,
+		       (unsigned long long)(d->sum / d->count), d->min,
+		       delay_percentile(d, 50), delay_percentile(d, 90),
+		       d->max);
+	}
+
+	printf("\nreply pool: %u slots taken, %u exhausted, %u in use max\n",
+	       reply->scheduled, reply->pool_exhausted, reply->in_use_max);
+	printf("sent: %u replies, %u publications\n",
+	       replay_counters.sends, replay_counters.publishes);
+	printf("health faults raised: %u\n", replay_counters.faults);
+}
+
+int main(int argc, char **argv)
+{
+	struct record *records;
+	double start, elapsed, due;
+	u32_t offset = 0, span;
+	int paced = 0, runs = 1;
+	int count, run, i, opt;
+	u64_t total = 0;
+
+	while ((opt = getopt(argc, argv, "pn:")) != -1) {
+		switch (opt) {
+		case 'p':
+			paced = 1;
+			break;
+		case 'n':
+			runs = atoi(optarg);
+			break;
+		default:
+			goto usage;
+		}
+	}
+
+	if (optind != argc - 1 || runs < 1) {
+		goto usage;
+	}
+
+	count = load_capture(argv[optind], &records);
+	if (count <= 0) {
+		fprintf(stderr, "%s: no trace records\n", argv[optind]);
+		return 1;
+	}
+
+	fw_main();
+	if (!replay_comp) {
+		fprintf(stderr, "firmware did not initialize mesh\n");
+		return 1;
+	}
+
+	/* Later runs start well clear of the previous transactions */
+	span = records[count - 1].timestamp - records[0].timestamp +
+	       K_SECONDS(10);
+
+	start = wall_now();
+
+	for (run = 0; run < runs; run++, offset += span) {
+		for (i = 0; i < count; i++) {
+			replay_now_ms = records[i].timestamp -
+					records[0].timestamp + offset;
+
+			if (paced) {
+				due = start + replay_now_ms / 1000.0;
+				while (wall_now() < due) {
+					usleep(100);
+				}
+			}
+
+			replay_run_timers();
+			dispatch(&records[i]);
+			total++;
+		}
+	}
+
+	elapsed = wall_now() - start;
+
+	report(total, elapsed);
+	return 0;
+
+usage:
+	fprintf(stderr, "usage: %s [-p] [-n runs] capture.log\n", argv[0]);
+	return 2;
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __REPLAY_H__
+#define __REPLAY_H__
+
+#include <zephyr/types.h>
+#include <bluetooth/mesh.h>
+
+/* Side effects of the model code, counted by the stubs */
+struct replay_counters {
+	u32_t sends;		/* bt_mesh_model_send() calls */
+	u32_t publishes;	/* bt_mesh_model_publish() calls */
+	u32_t pwm_writes;	/* pwm_pin_set_usec() calls */
+	u32_t faults;		/* health_fault_raise() calls */
+};
+
+extern struct replay_counters replay_counters;
+
+/* Replay clock, in ms: what k_uptime_get() returns */
+extern u32_t replay_now_ms;
+
+/* Unicast address of the first element, as if provisioned */
+#define REPLAY_ELEM_ADDR	0x0001
+
+/* Composition registered by the firmware's bt_mesh_init() call */
+extern const struct bt_mesh_comp *replay_comp;
+
+/* Firmware entry point, main() renamed at build time */
+void fw_main(void);
+
+/* Run the wheel timers due at replay_now_ms, in deadline order */
+void replay_run_timers(void);
+
+#endif	/* __REPLAY_H__ */
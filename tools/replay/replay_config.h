@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Configuration the model code is built with for the replay: the
+ * Kconfig.app defaults and the prj.conf mesh settings. Keep in sync
+ * when they change, so the host runs what the device runs.
+ */
+
+#ifndef __REPLAY_CONFIG_H__
+#define __REPLAY_CONFIG_H__
+
+#define CONFIG_SYS_LOG_FOTA_LEVEL	0
+
+#define CONFIG_APP_PWM_WHITE		1
+#define CONFIG_APP_PWM_WHITE_DEV	"PWM_0"
+#define CONFIG_APP_PWM_WHITE_PIN	0
+#define CONFIG_APP_PWM_WHITE_PIN_CEILING 255
+#define CONFIG_APP_SCENE_COUNT		16
+#define CONFIG_APP_PUB_HOLDOFF		100
+#define CONFIG_APP_PUB_TOKEN_MS		1000
+#define CONFIG_APP_PUB_BURST		3
+#define CONFIG_APP_TIMER_WHEEL_TICK	10
+#define CONFIG_APP_TIMER_WHEEL_SLOTS	64
+#define CONFIG_APP_REPLY_POOL_SIZE	4
+#define CONFIG_APP_EFFECT_TICK		20
+#define CONFIG_APP_HEALTH_FAULT_HOLD	10000
+#define CONFIG_APP_LOAD_ADAPT		1
+#define CONFIG_APP_LOAD_PERIOD		1000
+
+#define CONFIG_BT_MESH_RELAY		1
+#define CONFIG_BT_MESH_GATT_PROXY	1
+#define CONFIG_BT_MESH_MSG_CACHE_SIZE	20
+
+#endif	/* __REPLAY_CONFIG_H__ */
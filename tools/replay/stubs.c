@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) 2017 Linaro Limited
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Host implementations of what the model code links against: the
+ * kernel, mesh and driver calls, plus the application services which
+ * need hardware (timer wheel, scene flash storage, health).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <zephyr.h>
+#include <gpio.h>
+#include <pwm.h>
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/mesh.h>
+
+#include "app_work_queue.h"
+#include "timer_wheel.h"
+#include "scene.h"
+#include "health.h"
+#include "product_id.h"
+#include "replay.h"
+
+struct replay_counters replay_counters;
+u32_t replay_now_ms;
+const struct bt_mesh_comp *replay_comp;
+
+/* Kernel */
+
+s64_t k_uptime_get(void)
+{
+	return replay_now_ms;
+}
+
+u32_t k_uptime_get_32(void)
+{
+	return replay_now_ms;
+}
+
+u32_t k_cycle_get_32(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Deterministic, so that runs are comparable */
+u32_t sys_rand32_get(void)
+{
+	static u32_t state = 0x2545f491;
+
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+static struct device dummy_dev = { .name = "replay" };
+
+struct device *device_get_binding(const char *name)
+{
+	return &dummy_dev;
+}
+
+/* Drivers */
+
+int gpio_pin_configure(struct device *port, u32_t pin, int flags)
+{
+	return 0;
+}
+
+int gpio_pin_write(struct device *port, u32_t pin, u32_t value)
+{
+	return 0;
+}
+
+int pwm_pin_set_usec(struct device *dev, u32_t pwm, u32_t period,
+		     u32_t pulse)
+{
+	replay_counters.pwm_writes++;
+	return 0;
+}
+
+/* Buffers */
+
+void *net_buf_simple_add(struct net_buf_simple *buf, size_t len)
+{
+	u8_t *tail = buf->data + buf->len;
+
+	if (net_buf_simple_tailroom(buf) < len) {
+		fprintf(stderr, "net_buf_simple overflow\n");
+		abort();
+	}
+
+	buf->len += len;
+	return tail;
+}
+
+void *net_buf_simple_pull(struct net_buf_simple *buf, size_t len)
+{
+	if (buf->len < len) {
+		fprintf(stderr, "net_buf_simple underflow\n");
+		abort();
+	}
+
+	buf->len -= len;
+	buf->data += len;
+	return buf->data - len;
+}
+
+/* Bluetooth */
+
+int bt_enable(bt_ready_cb_t cb)
+{
+	cb(0);
+	return 0;
+}
+
+int bt_mesh_init(const struct bt_mesh_prov *prov,
+		 const struct bt_mesh_comp *comp)
+{
+	size_t i, j;
+
+	for (i = 0; i < comp->elem_count; i++) {
+		comp->elem[i].addr = REPLAY_ELEM_ADDR + i;
+
+		for (j = 0; j < comp->elem[i].model_count; j++) {
+			comp->elem[i].models[j].elem_idx = i;
+		}
+		for (j = 0; j < comp->elem[i].vnd_model_count; j++) {
+			comp->elem[i].vnd_models[j].elem_idx = i;
+		}
+	}
+
+	replay_comp = comp;
+	return 0;
+}
+
+void bt_mesh_model_msg_init(struct net_buf_simple *msg, u32_t opcode)
+{
+	net_buf_simple_init(msg, 0);
+
+	if (opcode < 0x100) {
+		net_buf_simple_add_u8(msg, opcode);
+	} else if (opcode < 0x10000) {
+		net_buf_simple_add_u8(msg, opcode >> 8);
+		net_buf_simple_add_u8(msg, opcode);
+	} else {
+		net_buf_simple_add_u8(msg, opcode >> 16);
+		net_buf_simple_add_le16(msg, opcode);
+	}
+}
+
+int bt_mesh_model_send(struct bt_mesh_model *model,
+		       struct bt_mesh_msg_ctx *ctx,
+		       struct net_buf_simple *msg,
+		       const void *cb, void *cb_data)
+{
+	replay_counters.sends++;
+	return 0;
+}
+
+int bt_mesh_model_publish(struct bt_mesh_model *model)
+{
+	replay_counters.publishes++;
+	return 0;
+}
+
+struct bt_mesh_elem *bt_mesh_model_elem(struct bt_mesh_model *mod)
+{
+	return &replay_comp->elem[mod->elem_idx];
+}
+
+int bt_mesh_fault_update(struct bt_mesh_elem *elem)
+{
+	return 0;
+}
+
+/* Application work queue: work runs when submitted */
+
+struct k_work_q *_app_q;
+
+void app_wq_init(void)
+{
+}
+
+void app_wq_run(void)
+{
+}
+
+void app_wq_ram_report(void)
+{
+}
+
+/*
+ * Timer wheel: the replay clock jumps from one message to the next, so
+ * timers just keep their deadline (in the rounds field) and run when
+ * the replay reaches it.
+ */
+
+#define MAX_TIMERS	32
+
+static struct wheel_timer *timers[MAX_TIMERS];
+static int timer_count;
+
+void timer_wheel_init(void)
+{
+}
+
+void wheel_timer_init(struct wheel_timer *timer, wheel_timer_fn_t fn)
+{
+	if (timer_count == MAX_TIMERS) {
+		fprintf(stderr, "Too many wheel timers\n");
+		abort();
+	}
+
+	timer->fn = fn;
+	timer->armed = false;
+	timers[timer_count++] = timer;
+}
+
+void wheel_timer_arm(struct wheel_timer *timer, u32_t delay_ms,
+		     u32_t slack_ms)
+{
+	timer->rounds = replay_now_ms + delay_ms;
+	timer->armed = true;
+}
+
+void wheel_timer_cancel(struct wheel_timer *timer)
+{
+	timer->armed = false;
+}
+
+void replay_run_timers(void)
+{
+	struct wheel_timer *next;
+	int i;
+
+	while (1) {
+		next = NULL;
+
+		for (i = 0; i < timer_count; i++) {
+			if (timers[i]->armed &&
+			    (s32_t)(timers[i]->rounds - replay_now_ms) <= 0 &&
+			    (!next ||
+			     (s32_t)(timers[i]->rounds - next->rounds) < 0)) {
+				next = timers[i];
+			}
+		}
+
+		if (!next) {
+			break;
+		}
+
+		next->armed = false;
+		next->fn(next);
+	}
+}
+
+/* Scene table, in RAM only */
+
+static struct {
+	u16_t number;
+	u8_t levels[SCENE_CHANNELS];
+} scenes[CONFIG_APP_SCENE_COUNT];
+
+int scene_init(void)
+{
+	memset(scenes, 0, sizeof(scenes));
+	return 0;
+}
+
+static u8_t *scene_find(u16_t number)
+{
+	int i;
+
+	for (i = 0; number != SCENE_NONE && i < ARRAY_SIZE(scenes); i++) {
+		if (scenes[i].number == number) {
+			return scenes[i].levels;
+		}
+	}
+
+	return NULL;
+}
+
+int scene_get(u16_t number, u8_t *levels)
+{
+	u8_t *entry = scene_find(number);
+
+	if (!entry) {
+		return -ENOENT;
+	}
+
+	memcpy(levels, entry, SCENE_CHANNELS);
+	return 0;
+}
+
+int scene_store(u16_t number, const u8_t *levels)
+{
+	u8_t *entry;
+	int i;
+
+	if (number == SCENE_NONE) {
+		return -EINVAL;
+	}
+
+	entry = scene_find(number);
+	for (i = 0; !entry && i < ARRAY_SIZE(scenes); i++) {
+		if (scenes[i].number == SCENE_NONE) {
+			scenes[i].number = number;
+			entry = scenes[i].levels;
+		}
+	}
+
+	if (!entry) {
+		return -ENOMEM;
+	}
+
+	memcpy(entry, levels, SCENE_CHANNELS);
+	return 0;
+}
+
+int scene_delete(u16_t number)
+{
+	int i;
+
+	for (i = 0; number != SCENE_NONE && i < ARRAY_SIZE(scenes); i++) {
+		if (scenes[i].number == number) {
+			scenes[i].number = SCENE_NONE;
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+
+int scene_list(u16_t *numbers, int max)
+{
+	int count = 0;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(scenes) && count < max; i++) {
+		if (scenes[i].number != SCENE_NONE) {
+			numbers[count++] = scenes[i].number;
+		}
+	}
+
+	return count;
+}
+
+/* Health */
+
+struct bt_mesh_health health_srv;
+
+void health_init(const struct health_ops *ops)
+{
+}
+
+void health_fault_raise(u8_t fault)
+{
+	replay_counters.faults++;
+}
+
+void health_wq_latency(u32_t us)
+{
+}
+
+void health_flash_erased(u32_t len, u32_t elapsed_ms)
+{
+}
+
+/* Product ID */
+
+const struct product_id_t *product_id_get(void)
+{
+	static const struct product_id_t id = {
+		.name = "replay",
+		.number = 0,
+	};
+
+	return &id;
+}